@@ -18,6 +18,7 @@ using std::vector;
 #include <cstring>
 #include <cassert>
 #include <memory>
+#include <algorithm>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_odeiv2.h>
@@ -26,6 +27,7 @@ using std::vector;
 #include "Coordinates.h"
 #include "WorldSize.cpp"
 #include "Cell.h"
+#include "MemoryPool.h"
 using std::unique_ptr;
 using std::shared_ptr;
 #include <sstream>
@@ -39,34 +41,27 @@ using namespace std;
 constexpr CellFormalism Cancer::classId_;
 constexpr char Cancer::classKW_[];
 constexpr uint32_t Cancer::odesystemsize_;
+constexpr int Cancer::Number_Of_Parameters_;
+std::shared_ptr<const Cancer::GeneParams> Cancer::shared_gene_params_;
+Cancer::StepDecay Cancer::step_decay_;
 
 // ============================================================================
 //                                Constructors
 // ============================================================================
 Cancer::Cancer(const Cancer &model) :
-Cell(model){
+Cell(model),
+gene_params_(model.gene_params_),
+GenesInteractionsMatrix_(model.GenesInteractionsMatrix_),
+KinParam_(model.KinParam_){
     phylogeny_id_.push_back(this->id());
     phylogeny_t_.push_back(Simulation::sim_time());
-    internal_state_ = new double[odesystemsize_];
-    memcpy(internal_state_, model.internal_state_, odesystemsize_ * sizeof (*internal_state_));
-
     this->Number_Of_Genes_ = model.Number_Of_Genes_;
+    S2_ = model.S2_;
 
-
-    mRNA_array_ = new double[Number_Of_Genes_];
-    Protein_array_ = new double[Number_Of_Genes_+1];
-    TrueJumpCounts_array_ = new int[Number_Of_Genes_];
-   
-     memcpy(mRNA_array_, model.mRNA_array_, Number_Of_Genes_ * sizeof (*mRNA_array_));
-     memcpy(Protein_array_, model.Protein_array_, (Number_Of_Genes_+1) * sizeof (*Protein_array_));
-     memcpy(TrueJumpCounts_array_, model.TrueJumpCounts_array_, Number_Of_Genes_ * sizeof (*TrueJumpCounts_array_));
-     
-
-    KinParam_ = new double[Number_Of_Parameters_];
-    GenesInteractionsMatrix_ = new double[Number_Of_Genes_ * Number_Of_Genes_];
-
-    memcpy(KinParam_, model.KinParam_, Number_Of_Parameters_ * sizeof (*KinParam_));
-    memcpy(GenesInteractionsMatrix_, model.GenesInteractionsMatrix_, Number_Of_Genes_ * Number_Of_Genes_ * sizeof (*GenesInteractionsMatrix_));
+    // internal state, mRNA, proteins and jump counts are all copied at once,
+    // the gene network parameters are shared
+    AllocateArrays();
+    memcpy(arrays_block_, model.arrays_block_, arrays_size());
 }
 
 /**
@@ -87,14 +82,10 @@ Cancer::Cancer(CellType cellType,
      pos_.y = WorldSize::size().y/2. + 3.*(Alea::gaussian_random_0_2());
      pos_.z = WorldSize::size().z/2. + 4.*(Alea::gaussian_random_0_2());
   
-    internal_state_ = new double[odesystemsize_];
+    get_GeneParams();
     internal_state_[Type] = 1.;
     internal_state_[S_S] = 0.; 
-    
-    get_GeneParams();
-    mRNA_array_ = new double[Number_Of_Genes_];
-    Protein_array_ = new double[Number_Of_Genes_+1];
-    TrueJumpCounts_array_ = new int[Number_Of_Genes_];
+    UpdateCellType();
 
 
     for (int i = 0; i <  Number_Of_Genes_; i++) {
@@ -123,7 +114,7 @@ S2_ =0.;
  */
 Cancer::Cancer(gzFile backup_file) :
     Cell(backup_file) {
-    internal_state_ = new double[odesystemsize_];
+    get_GeneParams();
   Load(backup_file);
 }
 
@@ -131,13 +122,7 @@ Cancer::Cancer(gzFile backup_file) :
 //                                 Destructor
 // ============================================================================
 Cancer::~Cancer() noexcept {
-  delete [] internal_state_;
-
-    delete [] mRNA_array_;
-    delete [] Protein_array_;
-    delete [] TrueJumpCounts_array_;
-    delete [] GenesInteractionsMatrix_;
-    delete [] KinParam_;
+  MemoryPool::Deallocate(arrays_block_, arrays_size());
 }
 
 // ============================================================================
@@ -155,6 +140,19 @@ Grow(dt);
 
 }
 
+//update all the cells at once: the decays of the molecules over a whole
+//time-step, which most cells go through without any burst, are computed once
+void Cancer::BatchUpdate(Cell* const* cells, size_t nb_cells, const double& dt) {
+  if (step_decay_.dt != dt) {
+    const GeneParams& p = *SharedGeneParams();
+    step_decay_.e0 = exp(-dt * p.d0);
+    step_decay_.e1_S = exp(-dt * p.D1_S);
+    step_decay_.e1_D = exp(-dt * p.D1_D);
+    step_decay_.dt = dt;
+  }
+  InternalUpdates(cells, nb_cells, dt);
+}
+
 //movement 'motile'
 Coordinates<double> Cancer::MotileDisplacement(const double& dt) {
  
@@ -251,14 +249,279 @@ return count_D;
 }
 
 
+// ============================================================================
+//                    PDMP engine (bursty gene expression)
+// ============================================================================
+namespace {
+
+/** The bound of the burst rate of gene 0 may widen by this fraction with the
+ *  changes of the signal before it is computed again */
+const double kSignalSlack = 0.25;
+
+/** Scratch arrays of the PDMP of NG genes, on the stack */
+template <int NG>
+struct PdmpScratch {
+  explicit PdmpScratch(int) {}
+  double pmax[NG];       // upper bound of the proteins over the window
+  double pmin[NG];       // lower bound of the proteins over the window
+};
+
+/** When the number of genes is only known at run time, buffers of the
+ *  thread, reused from one cell to the next */
+template <>
+struct PdmpScratch<0> {
+  explicit PdmpScratch(int nb_genes) {
+    static thread_local std::vector<double> buffer;
+    buffer.resize(2 * nb_genes);
+    pmax = buffer.data();
+    pmin = pmax + nb_genes;
+  }
+  double* pmax;
+  double* pmin;
+};
+
+} // namespace
+
+/**
+ * PDMP of the mRNA and proteins of a cell (from harissa/simulation/pdmp.py):
+ * they evolve deterministically between bursts of mRNA, drawn by thinning.
+ *
+ * Each gene i has a bound of its burst rate kon_i (KonBound_array_) over a
+ * window of GeneParams::bound_window hours, from the bounds of the proteins
+ * over the window: the proteins degrade slowly, so that the inhibitions are
+ * kept with the lower bound of the proteins. Candidate jumps come at the
+ * rate Tau, the sum of the bounds, and fall in the share of gene i with
+ * probability KonBound_i / Tau; the candidate is then a burst of gene i with
+ * probability kon_i / KonBound_i, kon_i being evaluated at the time of the
+ * candidate, and a phantom jump otherwise. Only the sigmoid of gene i is
+ * evaluated.
+ *
+ * After a burst of gene i, only the bounds of the genes that i activates
+ * are computed again, for the rest of the window. The bound of gene 0 is
+ * widened by the largest slope of kon_0 with the signal, and computed again
+ * when the signal has moved too far. All the bounds are computed again when
+ * the window ends and at division (see ResetPdmp).
+ *
+ * The time to the next candidate is kept as the unit exponential that is
+ * left (JumpHazard_), consumed at the rate Tau: Tau may change before the
+ * candidate without drawing it again.
+ *
+ * NG is the number of genes, 0 if it is only known at run time. The
+ * constants come from the shared GeneParams.
+ */
+template <int NG>
+class Cancer::Pdmp {
+ public:
+  explicit Pdmp(Cancer& cell) : cell_(cell),
+                                params_(*cell.gene_params_),
+                                nb_genes_(cell.Number_Of_Genes_),
+                                scratch_(nb_genes_) {}
+
+  /** Advance the cell by dt. S_S and x are the signals of Kon */
+  void Step(double dt, double S_S, double x);
+
+ private:
+  int n() const { return NG > 0 ? NG : nb_genes_; }
+
+  /** Deterministic evolution of the mRNA and proteins during thetime */
+  void ExactEvol(double thetime);
+
+  /** Deterministic evolution, given the decays of the mRNA (e0) and of the
+   *  proteins of gene 0 (e1_S) and of the others (e1_D) */
+  void Decay(double e0, double e1_S, double e1_D);
+
+  /** Open a window at time t of the step and bound the burst rates of all
+   *  the genes over it */
+  void NewWindow(double t);
+
+  /** Bounds of the proteins until the end of the window */
+  void ProteinBounds();
+
+  /** Bound the burst rate of gene i with the bounds of the proteins */
+  void BoundGene(int i);
+
+  /** Bound of the burst rate of gene 0, widened by the changes of the
+   *  signal */
+  double Bound0() const;
+
+  /** Sum of the bounds of the burst rates */
+  double Tau() const;
+
+  /** Burst rate of gene i, with the proteins P_act on the activating
+   *  interactions and P_inh on the inhibiting ones */
+  double Kon(int i, const double* P_act, const double* P_inh) const;
+
+  Cancer& cell_;
+  const GeneParams& params_;
+  const int nb_genes_;
+  PdmpScratch<NG> scratch_;
+  double signal_;  // input of gene 0 from the other cells
+};
+
+template <int NG>
+void Cancer::Pdmp<NG>::Step(double dt, double S_S, double x) {
+  const GeneParams& p = params_;
+  const double* P = cell_.Protein_array_;
+  double* M = cell_.mRNA_array_;
+  double* KonBound = cell_.KonBound_array_;
+  // signaling between the stem cells or diffusion; signaling between
+  // differentiated cells is unused
+  signal_ = (S_S > 0.) ? S_S * x : 0.;
+
+  if (cell_.JumpHazard_ < 0.) cell_.JumpHazard_ = Alea::exponential_random(1.);
+
+  if (cell_.BoundEnd_ < dt) {
+    NewWindow(0.);
+  } else if (Bound0() > (1. + kSignalSlack) * KonBound[0]) {
+    ProteinBounds();
+    BoundGene(0);
+  }
+  double Tau = this->Tau();
+
+  double currentTime = 0.;
+  while (true) {
+    // no candidate before the end of the step or of the window
+    const double end = std::min(dt, cell_.BoundEnd_);
+    if (cell_.JumpHazard_ >= (end - currentTime) * Tau) {
+      if (end == dt) break;
+      cell_.JumpHazard_ -= (end - currentTime) * Tau;
+      ExactEvol(end - currentTime);
+      currentTime = end;
+      NewWindow(currentTime);
+      Tau = this->Tau();
+      continue;
+    }
+
+    //-- Advance until the candidate, then solve ODE with new init values ---
+    const double DeltaT = cell_.JumpHazard_ / Tau;
+    ExactEvol(DeltaT);
+    currentTime += DeltaT;
+    cell_.JumpHazard_ = Alea::exponential_random(1.);
+
+    // ----------------- Select the gene, then the burst if any ----------
+    double u = Alea::random() * Tau;
+    int i = 0;
+    double share = Bound0();
+    while (i < n() - 1 && u >= share) {
+      u -= share;
+      share = KonBound[++i];
+    }
+
+    if (u < Kon(i, P, P)) { // a real gene, it's a true jump
+      cell_.TrueJumpCounts_array_[i] += 1;
+      M[i] += Alea::exponential_random(p.burst_size);
+      // the upper bound of the proteins of gene i no longer holds
+      const double* W = (p.K1 >= p.K0) ? p.activations.data()
+                                       : p.inhibitions.data();
+      ProteinBounds();
+      for (int g = 0; g < n(); g++) {
+        if (W[g + n() * i] != 0.) BoundGene(g);
+      }
+      Tau = this->Tau();
+    } else {
+      cell_.PhantomJumpCounts_ += 1;
+    }
+  }
+
+  // -------------------------- If next jump is too far away, solve ODE ----------
+  cell_.JumpHazard_ -= (dt - currentTime) * Tau;
+  cell_.BoundEnd_ -= dt;
+  const StepDecay& decay = Cancer::step_decay_;
+  if (currentTime == 0. && decay.dt == dt) {
+    Decay(decay.e0, decay.e1_S, decay.e1_D);
+  } else {
+    ExactEvol(dt - currentTime);
+  }
+}
+
+template <int NG>
+void Cancer::Pdmp<NG>::ExactEvol(double thetime) {
+  const GeneParams& p = params_;
+  // gene 0 is degraded at the stem cell rate, the others at the
+  // differentiated cell rate
+  Decay(exp(-thetime * p.d0), exp(-thetime * p.D1_S), exp(-thetime * p.D1_D));
+}
+
+template <int NG>
+void Cancer::Pdmp<NG>::Decay(double e0, double e1_S, double e1_D) {
+  const GeneParams& p = params_;
+  double* P = cell_.Protein_array_;
+  double* M = cell_.mRNA_array_;
+  for (int i = 0; i < n(); i++) {
+    const double e1 = (i == 0) ? e1_S : e1_D;
+    const double m = M[i];
+    M[i] = m * e0;
+    P[i] = p.mRNA_to_protein[i] * m * (e1 - e0) + P[i] * e1;
+  }
+}
+
+template <int NG>
+void Cancer::Pdmp<NG>::NewWindow(double t) {
+  cell_.BoundEnd_ = t + params_.bound_window;
+  ProteinBounds();
+  for (int i = 0; i < n(); i++) {
+    BoundGene(i);
+  }
+}
+
+template <int NG>
+void Cancer::Pdmp<NG>::ProteinBounds() {
+  const GeneParams& p = params_;
+  const double* P = cell_.Protein_array_;
+  const double* M = cell_.mRNA_array_;
+  // Without bursts, the proteins of a gene only gain what its mRNA makes
+  // and only lose what they degrade, during the window or what is left of it
+  for (int i = 0; i < n(); i++) {
+    scratch_.pmax[i] = P[i] + p.mRNA_to_protein[i] * M[i] * p.window_rise[i];
+    scratch_.pmin[i] = P[i] * p.window_decay[i];
+  }
+}
+
+template <int NG>
+void Cancer::Pdmp<NG>::BoundGene(int i) {
+  const GeneParams& p = params_;
+  // kon_i grows with sigma_i iff K1 > K0
+  const double kon = (p.K1 >= p.K0) ? Kon(i, scratch_.pmax, scratch_.pmin)
+                                    : Kon(i, scratch_.pmin, scratch_.pmax);
+  cell_.KonBound_array_[i] = kon + p.kon_floor;
+  if (i == 0) cell_.BoundSignal_ = signal_;
+}
+
+template <int NG>
+double Cancer::Pdmp<NG>::Bound0() const {
+  return cell_.KonBound_array_[0] +
+         params_.signal_slope * std::fabs(signal_ - cell_.BoundSignal_);
+}
+
+template <int NG>
+double Cancer::Pdmp<NG>::Tau() const {
+  double Tau = Bound0();
+  for (int i = 1; i < n(); i++) {
+    Tau += cell_.KonBound_array_[i];
+  }
+  return Tau;
+}
+
+template <int NG>
+double Cancer::Pdmp<NG>::Kon(int i, const double* P_act,
+                             const double* P_inh) const {
+  const GeneParams& p = params_;
+  // J acts on I at i + n * j, one of the activation and the inhibition is 0
+  const double* A = p.activations.data();
+  const double* I = p.inhibitions.data();
+  // Basal activity of the genes
+  double initval = (i == 0) ? -3.0 + signal_ : -5.0;
+  for (int j = 0; j < n(); j++) {
+    initval += P_act[j] * A[i + n() * j] + P_inh[j] * I[i + n() * j];
+  }
+  const double sigma = 1. / (1. + exp(-initval));
+  return (1. - sigma) * p.K0 + sigma * p.K1;
+}
+
 //update the molecular contents
 void Cancer::ODE_update(const double& dt){
 
-double t = 0., t1 = dt;
-//define the cell type
-if (this->internal_state_[Type] == 1.){cell_type_ = CellType::STEM;
-   }else {
- cell_type_ = CellType::DIFF_S;}
+//the cell type is only changed at division (see UpdateCellType)
  
 
 // the number of cells in contact S-S or D-D
@@ -279,160 +542,16 @@ internal_state_[D_D] = count_Neib_Syp();
 break;}
 }
 
-
-       // Here: PDMP (intracellular signalling)*
-           // from harissa/simulation/pdmp.py
-           // Default bursting parameters
-           double a0 = KinParam_[3]; //0;
-           double a1 = KinParam_[4];/// change to normalize protein
-           double a2 = KinParam_[5];
-           // Default degradation rates
-           double d0 = KinParam_[0];  // mRNA degradation rates
-           double D1_D= KinParam_[2];  //protein degradation rate of differentiated cell
-     	   double D1_S = KinParam_[1];  //protein degradation rate of stem cell
-	   
-           const double K0 = a0*d0;
-           const double K1 = a1*d0;
-           
-           bool jump = false;
-           
-           double *S1 = new double[Number_Of_Genes_]; //S1
-           for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-               S1[i] = 0.;
-           }
-           
-           const double r = a2;
-           double currentTime = 0.;
-           double DeltaT = 0.;
-           double *PPmax = new double[Number_Of_Genes_]; //Pmax
-           double *ProbaArray = new double[Number_Of_Genes_+1];
-           
-           for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-               PPmax[i] = 0.;
-           }
-           for (u_int32_t i = 0; i < Number_Of_Genes_+1; i++) {
-               ProbaArray[i] = 0.;
-           }
-           
-           double *KKon = new double[Number_Of_Genes_]; //Kon
-           for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-               KKon[i] = 0.;
-           }
-           
-           for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-	     if (i== 0){
-               S1[i] = d0 * D1_S * a2 / K1;}
-	     else { S1[i] = d0 * D1_D * a2 / K1;}
-           }
-	   
-           while (Time_NextJump_ < t1){
-               
-               double *Sigma = new double[Number_Of_Genes_]; //Sigma
-               
-               for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-                   Sigma[i] = 0.;
-               }
-               
-               double Tau = 0.;
-               
-               // -------------------------- ------------------------------- ------------------
-               //-- Advance until next jump, then solve ODE with new init values ---
-               // -------------------------- ------------------------------- ------------------
-               
-               Intracellular_ExactEvol(std::max(Time_NextJump_ - currentTime, 0.), Protein_array_, mRNA_array_, S1);
-               
-               if ((ithGene_ < Number_Of_Genes_)&&(ithGene_ >= 0)) {// i represents a real gene, it's a true jump
-                   jump = true;
-                   TrueJumpCounts_array_[ithGene_] += 1;
-                 mRNA_array_[ithGene_] += Alea::exponential_random(1./r);
-               } else {
-                   PhantomJumpCounts_ += 1;
-               }
-               
-               
-               
-               // ----------------- Calculate Kon & Tau ----------
-               double thetime_D = log(d0 / D1_D) / (d0 - D1_D);
-	           double thetime_S = log(d0 / D1_S) / (d0 - D1_S);
-               
-               for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-		            if (i == 0) { 
-                        PPmax[i] = Protein_array_[i] + (S1[i] / (d0 - D1_S)) * mRNA_array_[i]*(exp(-thetime_S * D1_S) - exp(-thetime_S * d0));}
-		             else {
-		                 PPmax[i] = Protein_array_[i] + (S1[i] / (d0 - D1_D)) * mRNA_array_[i]*(exp(-thetime_D * D1_D) - exp(-thetime_D * d0));}
-
-               }
-               
-               //for contact cell-cell
-               //Get_Sigma(Sigma, PPmax, false, internal_state_[S_S], KinParam_[9], internal_state_[D_D], KinParam_[14]);
-               
-
-               //for diffusion 
-//               Get_Sigma(Sigma, PPmax, false, 1., S2_, internal_state_[D_D], KinParam_[14]);
-                Get_Sigma(Sigma, PPmax, false, S2_, 1., internal_state_[D_D], KinParam_[14]);
-             
-               for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-                   
-                   KKon[i] = (1. - Sigma[i]) * K0 + Sigma[i] * K1 + exp(-10. * log(10.)); // Fix precision errors
-                   
-                   Tau += KKon[i];
-                   
-               }
-               
-               // ----------------- Calculate Delta = Next Jump Time ----------
-               
-               //the waiting time before the next jump
-               DeltaT = Alea::exponential_random(1./Tau);
-               
-               // ---------------------------------------- Select NEXT burst ------------------
-               // ----------------- Construct probability array ----------
-               double Proba_no_jump = 1.;
-               
-               //for contact cell-cell
-               //Get_Sigma(Sigma, Protein_array_, true, internal_state_[S_S], KinParam_[9],internal_state_[D_D], KinParam_[14]);
-               
-               
-               //for diffusion  
-         //      Get_Sigma(Sigma, Protein_array_, true, 1., S2_, internal_state_[D_D], KinParam_[14]);
-             Get_Sigma(Sigma, Protein_array_, true, S2_, 1., internal_state_[D_D], KinParam_[14]);
- 
-              for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-                   
-                   KKon[i] = (1. - Sigma[i]) * K0 + Sigma[i]*K1;
-                   ProbaArray[i] = KKon[i] / Tau;    
-                   Proba_no_jump = Proba_no_jump - ProbaArray[i];
-               }
-               
-               
-               ProbaArray[Number_Of_Genes_] = Proba_no_jump;
-               
-               // ----------------- Find gene # from probability array --------
-               
-               ithGene_ =  Alea::discrete_distribution(Number_Of_Genes_+1, ProbaArray);
-               
-               delete [] Sigma;
-               
-               currentTime = Time_NextJump_;
-               
-               Time_NextJump_ += DeltaT;
-               
-           }
-
-           
-           // -------------------------- ------------------------------- ------------------
-           // -------------------------- If next jump is too far away, solve ODE ----------
-           // -------------------------- ------------------------------- ------------------
-           Time_NextJump_ -= dt;
-           
-           Intracellular_ExactEvol(t1-currentTime, Protein_array_, mRNA_array_, S1);
-           
-           delete [] PPmax;
-           delete [] ProbaArray;
-           delete [] KKon;
-           delete [] S1;
- }
-
-            
+    // PDMP (intracellular signalling), with the loops over the genes
+    // unrolled for the usual sizes of the network
+    const double signal_S = S2_, x = 1.;  // diffusion
+    switch (Number_Of_Genes_) {
+      case 2: Pdmp<2>(*this).Step(dt, signal_S, x); break;
+      case 3: Pdmp<3>(*this).Step(dt, signal_S, x); break;
+      case 4: Pdmp<4>(*this).Step(dt, signal_S, x); break;
+      default: Pdmp<0>(*this).Step(dt, signal_S, x); break;
+    }
+}
 
 void Cancer::UpdatePhylogeny(vector<int> phy_id, vector<double> phy_t, int sz) {
     phylogeny_id_.insert(phylogeny_id_.begin(), phy_id.begin(), phy_id.end());
@@ -442,6 +561,39 @@ void Cancer::UpdateType(double Mother_type) {
       internal_state_[Type] =  Mother_type;
 }
 
+//the cell type follows internal_state_[Type]; it is only set at creation and
+//division so that neighbours see the same type during the whole update
+void Cancer::UpdateCellType() {
+  if (cell_type_ == CellType::NICHE) return;
+  cell_type_ = (internal_state_[Type] == 1.) ? CellType::STEM : CellType::DIFF_S;
+}
+
+//size of the block holding the per-cell arrays: doubles first, then ints
+size_t Cancer::arrays_size() const {
+  size_t nb_doubles = odesystemsize_                         // internal_state_
+                      + Number_Of_Genes_                     // mRNA_array_
+                      + Number_Of_Genes_ + 1                 // Protein_array_
+                      + Number_Of_Genes_;                    // KonBound_array_
+  return nb_doubles * sizeof(double) + Number_Of_Genes_ * sizeof(int);
+}
+
+//allocate all the per-cell arrays in one zeroed block from the MemoryPool
+void Cancer::AllocateArrays() {
+  arrays_block_ = MemoryPool::Allocate(arrays_size());
+  memset(arrays_block_, 0, arrays_size());
+
+  double* block = static_cast<double*>(arrays_block_);
+  internal_state_ = block;
+  block += odesystemsize_;
+  mRNA_array_ = block;
+  block += Number_Of_Genes_;
+  Protein_array_ = block;
+  block += Number_Of_Genes_ + 1;
+  KonBound_array_ = block;
+  block += Number_Of_Genes_;
+  TrueJumpCounts_array_ = reinterpret_cast<int*>(block);
+}
+
 
 double num_division = 0.;
 
@@ -468,6 +620,7 @@ Cell* Cancer::Divide(void) {
     if (newCell->Protein_array_[0]> KinParam_[8]) { newCell->internal_state_[Type] =1.;}
     else{
         newCell->internal_state_[Type] =0.;}
+    newCell->UpdateCellType();
     
     this->SetNewProtein_stem_symmetric(Protein_array_, Number_Of_Genes_);
     this->SetNewRNA_stem_symmetric(mRNA_array_, Number_Of_Genes_);
@@ -476,6 +629,11 @@ Cell* Cancer::Divide(void) {
     if (this->Protein_array_[0]> KinParam_[8]) { this->internal_state_[Type] =1.;}
     else{
         this->internal_state_[Type] =0.;}
+    this->UpdateCellType();
+
+    // the proteins were shared, the PDMPs start again
+    newCell->ResetPdmp();
+    this->ResetPdmp();
   
   newCell->UpdatePhylogeny(phylogeny_id_, phylogeny_t_, phylogeny_id_.size());
   phylogeny_id_.push_back(this->id());
@@ -494,32 +652,6 @@ Cell* Cancer::Divide(void) {
   return newCell;
 }
 
-//update protein and mRNA
-
- void Cancer::Intracellular_ExactEvol(double thetime, double * P, double * M, double * S1) {
-        //degradation rates
-    double d0 = KinParam_[0];  // mRNA degradation rates                                                                                                                                
-    double D1_D= KinParam_[2];  //protein degradation rates of differentiated cell                                                                                                                                                                                  
-    double D1_S = KinParam_[1];  //protein degradation rates of stem cell                                                                                                                                                                                           
-    double Marr[Number_Of_Genes_];
-    double Parr[Number_Of_Genes_];
-
-    memcpy(Marr, M, Number_Of_Genes_ * sizeof (*M));
-    memcpy(Parr, P, Number_Of_Genes_ * sizeof (*P));
-    // New values:                                                                                                                                                                              
-    for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-      if (i == 0) {
-        M[i] = Marr[i] * exp(-thetime * d0);
-        P[i] = ((S1[i] / (d0 - D1_S)) * Marr[i]*(exp(-thetime * D1_S) - exp(-thetime * d0)) + Parr[i] * exp(-thetime * D1_S));
-      }
-      else {
-	M[i] = Marr[i] * exp(-thetime * d0);
-        P[i] = ((S1[i] / (d0 - D1_D)) * Marr[i]*(exp(-thetime * D1_D) - exp(-thetime * d0)) + Parr[i] * exp(-thetime * D1_D));
-      }
-      
- }
- }
-
 void Cancer::SetNewProtein_stem_symmetric(const double MotherProteins[],const int sz)const {                                                                                                                                         
     for (u_int32_t j = 0; j < sz; j++) {
       Protein_array_[j] =  MotherProteins[j]/2.;
@@ -538,45 +670,14 @@ void Cancer::Update_count_division( double Mother_division,const int s )const {
 
   }
 
-
-//Sigma function
-void Cancer::Get_Sigma( double *Sigma_i ,double * P, bool AcceptNegative, double S_S, const double x, double D_D, const double y ) {
-
-double Parr[Number_Of_Genes_];
- memcpy(Parr, P, Number_Of_Genes_ * sizeof (*P));
-
- double interIJ;
- double initval_i[Number_Of_Genes_];
-
-
-  for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
- // Basal activity for genes                                                                                                                                                               
-if ( i == 0){
-  initval_i[i] = -3.0;
-// signaling between the stem cells or diffusion
-  if (S_S > 0.) {initval_i[i] += S_S * x;}
-}
-
-else if ( i == 1){
-  initval_i[i] = -5.0;
-// signaling between differentiated cells
-//  if (D_D > 0.) {initval_i[i] += D_D * y;}
-}
-
-//other genes
-else {initval_i[i] = -5.0;}
-
- for (u_int32_t j = 0; j < Number_Of_Genes_; j++) {
-   interIJ = GenesInteractionsMatrix_[i + Number_Of_Genes_ * j]; // J acts on I                                                                                                                 
-    if (((interIJ > 0.)||AcceptNegative)) {
-      initval_i[i] += Parr[j] * interIJ;
-      }
- }
-}
-
- for (u_int32_t i = 0; i < Number_Of_Genes_; i++) {
-Sigma_i[i] = (1. / (1. + exp(-initval_i[i])));
-}
+//the bounds of the bursts no longer hold and the jump counts start again,
+//with the new cell type
+void Cancer::ResetPdmp() {
+  BoundEnd_ = 0.;
+  PhantomJumpCounts_ = 0;
+  for (int i = 0; i < Number_Of_Genes_; i++) {
+    TrueJumpCounts_array_[i] = 0;
+  }
 }
 
 
@@ -605,7 +706,26 @@ void Cancer::Load(gzFile backup_file) {
 // for the parameters
 
 double Cancer::get_GeneParams(void) {
-    KinParam_ = new double[Number_Of_Parameters_];
+    gene_params_ = SharedGeneParams();
+    KinParam_ = gene_params_->kin_param.data();
+    GenesInteractionsMatrix_ = gene_params_->interactions.data();
+    Number_Of_Genes_ = gene_params_->nb_genes;
+
+    // All the per-cell arrays live in one pooled block
+    AllocateArrays();
+
+    return 0;
+}
+
+//the gene network parameters of the run, read at the creation of the first cell
+std::shared_ptr<const Cancer::GeneParams> Cancer::SharedGeneParams() {
+    if (!shared_gene_params_) shared_gene_params_ = ReadGeneParams();
+    return shared_gene_params_;
+}
+
+//read kineticsparam.txt and GeneInteractionsMatrix.txt in the working directory
+std::shared_ptr<const Cancer::GeneParams> Cancer::ReadGeneParams() {
+    std::vector<double> kin_param(Number_Of_Parameters_);
 
     ////////////////////////////////////                                                                                                                                                            
     ifstream indatakin; // indata is like cin                                                                                                                                                       
@@ -630,7 +750,7 @@ string filename ="kineticsparam.txt";
             break;
         }// error
         else {
-            KinParam_[iter] = a;
+            kin_param[iter] = a;
             iter = iter + 1;
         }
     }
@@ -647,7 +767,7 @@ string filename ="kineticsparam.txt";
         std::cerr << "Error: file GeneInteractionsMatrix.txt could not be opened" << std::endl;
         exit(1);
     }
-    Number_Of_Genes_ = 0;
+    int nb_genes = 0;
     std::getline(indataf, line);
     std::stringstream ss(line);
     std::string word;
@@ -655,24 +775,24 @@ string filename ="kineticsparam.txt";
  int j = 0;
 
     while (ss >> word) {
-        Number_Of_Genes_ += 1;
+        nb_genes += 1;
     }
 
-     Number_Of_Genes_ -= 1; // to include title column                                                                                                                                              
+     nb_genes -= 1; // to include title column                                                                                                                                              
 
-  GenesInteractionsMatrix_ = new double[Number_Of_Genes_ * Number_Of_Genes_];
+  std::vector<double> interactions(nb_genes * nb_genes);
 
      while (std::getline(indataf, line)) {
         std::istringstream iss(line);
         iss >> word;
         j = 0;
-        while (j < Number_Of_Genes_) {
+        while (j < nb_genes) {
             if ((!(iss >> a))) {
                 std::cerr << "Error: possible value missing" << std::endl;
                 break;
             }// error                                                                                                                                                                               
             else {
-                GenesInteractionsMatrix_[(j + Number_Of_Genes_ * i)] = a;
+                interactions[(j + nb_genes * i)] = a;
                 j = j + 1;
     }
         }
@@ -683,8 +803,40 @@ string filename ="kineticsparam.txt";
 
      
      indataf.close();
- 
-    return 0;
+
+    std::shared_ptr<GeneParams> params = std::make_shared<GeneParams>();
+    params->nb_genes = nb_genes;
+    params->kin_param = std::move(kin_param);
+    params->interactions = std::move(interactions);
+
+    // constants of the PDMP
+    const std::vector<double>& kp = params->kin_param;
+    params->d0 = kp[0];
+    params->D1_S = kp[1];
+    params->D1_D = kp[2];
+    params->K0 = kp[3] * kp[0];
+    params->K1 = kp[4] * kp[0];
+    params->burst_size = 1. / kp[5];
+    params->kon_floor = exp(-10. * log(10.)); // Fix precision errors
+    params->signal_slope = fabs(params->K1 - params->K0) / 4.;
+    // the proteins lose at most 10% of their level during the window
+    params->bound_window = 0.1 / std::max(params->D1_S, params->D1_D);
+    for (int i = 0; i < nb_genes; i++) {
+        const double d0 = params->d0;
+        const double D1 = (i == 0) ? params->D1_S : params->D1_D;
+        const double S1 = d0 * D1 * kp[5] / params->K1;
+        // the proteins made by the mRNA of a gene peak at thetime
+        const double thetime = log(d0 / D1) / (d0 - D1);
+        const double t = std::min(thetime, params->bound_window);
+        params->mRNA_to_protein.push_back(S1 / (d0 - D1));
+        params->window_rise.push_back(exp(-t * D1) - exp(-t * d0));
+        params->window_decay.push_back(exp(-params->bound_window * D1));
+    }
+    for (double interIJ : params->interactions) {
+        params->activations.push_back(interIJ > 0. ? interIJ : 0.);
+        params->inhibitions.push_back(interIJ < 0. ? interIJ : 0.);
+    }
+    return params;
 }
 
 //print the output signal
@@ -712,6 +864,13 @@ double Cancer::get_output(InterCellSignal signal) const {
       return mRNA_array_[1];
     case InterCellSignal::CANCER_mRNA_P:
       return mRNA_array_[2];
+    case InterCellSignal::CANCER_TRUE_JUMPS: {
+      int count = 0;
+      for (int i = 0; i < Number_Of_Genes_; i++) count += TrueJumpCounts_array_[i];
+      return count;
+    }
+    case InterCellSignal::CANCER_PHANTOM_JUMPS:
+      return PhantomJumpCounts_;
     case InterCellSignal::S2:
       return S2_;
 
@@ -745,13 +904,13 @@ const Coordinates<double>& Cancer::gaussian_field_source(InterCellSignal signal)
 
 }
 
-std::vector<Coordinates<double>> Cancer::gaussian_field_targets(InterCellSignal signal) {
+void Cancer::gaussian_field_targets(InterCellSignal signal,
+                                    std::vector<Coordinates<double>>& targets) {
 
   (void)signal;
-  std::vector<Coordinates<double>> targets;
+  targets.clear();
   targets.push_back(pos());
   //targets.push_back(pos() + orientation());
-  return targets;
 }
 
 
@@ -772,5 +931,6 @@ bool Cancer::registered_ =
                         },
                         [](gzFile backup_file){
                           return static_cast<Cell*>(new Cancer(backup_file));
-                        }
+                        },
+                        &Cancer::BatchUpdate
     );
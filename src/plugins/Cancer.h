@@ -12,6 +12,9 @@
 // ============================================================================
 //                                   Includes
 // ============================================================================
+#include <memory>
+#include <vector>
+
 #include "Cell.h"
 
 /**
@@ -58,6 +61,7 @@ class Cancer : public Cell {
   //                              Public Methods
   // ==========================================================================
   void InternalUpdate(const double& dt) override;
+  static void BatchUpdate(Cell* const* cells, size_t nb_cells, const double& dt);
   Cell* Divide(void) override;
   
   void Save(gzFile backup_file) const override;
@@ -75,7 +79,8 @@ class Cancer : public Cell {
 // Fast Gaussian Transform -----------------------------------------
   double gaussian_field_weight(InterCellSignal signal) override;
   const Coordinates<double>& gaussian_field_source(InterCellSignal signal) override; 
-  std::vector<Coordinates<double>> gaussian_field_targets(InterCellSignal signal) override;
+  void gaussian_field_targets(InterCellSignal signal,
+                              std::vector<Coordinates<double>>& targets) override;
   // END Fast Gaussian Transform -------------------------------------
 
 
@@ -86,8 +91,9 @@ class Cancer : public Cell {
   Coordinates<double> MotileDisplacement(const double& dt) override;
   void Cell_update(const double& dt);  
   void UpdateType(double Mother_type); 
-  void Get_Sigma( double * sigma, double * P, bool AcceptNegative, double S_S, const double x, double D_D, const double y);
-  void Intracellular_ExactEvol(double DeltaT, double * P, double * M, double * S1);
+  void UpdateCellType();
+  void AllocateArrays();
+  size_t arrays_size() const;
   void ODE_update(const double& dt);
   void UpdatePhylogeny(std::vector<int> phy_id, std::vector<double> phy_t, int sz);
   void SetNewRNA_stem_symmetric(const double MotherRNA[],const  int sz)const ;
@@ -96,6 +102,7 @@ class Cancer : public Cell {
   double count_Neib_Syp();
   void Update_count_division(double Mother_division, const int s )const;
   void Update_count_division_mother(double Mother_division);
+  void ResetPdmp();
      
     
     // ==========================================================================
@@ -121,13 +128,53 @@ class Cancer : public Cell {
   int PhantomJumpCounts_= 0;
   int* TrueJumpCounts_array_;
 
-  double* GenesInteractionsMatrix_;
-  double* KinParam_;
+  /** Parameters of the gene regulatory network. They are read once per run
+   * and shared, read-only, by all the cells */
+  struct GeneParams {
+    int nb_genes;
+    std::vector<double> kin_param;      // Number_Of_Parameters_ kinetic parameters
+    std::vector<double> interactions;   // nb_genes^2, J acts on I at i + nb_genes*j
+
+    // constants of the PDMP, from kin_param
+    double d0;                          // mRNA degradation rate
+    double D1_S, D1_D;                  // protein degradation rates of gene 0, of the others
+    double K0, K1;                      // burst rates of an inactive, an active gene
+    double burst_size;                  // mean burst size
+    double kon_floor;                   // added to the bound of the burst rates
+    std::vector<double> mRNA_to_protein;  // S1/(d0 - D1) of each gene
+    double signal_slope;                // largest slope of kon_0 with the signal, |K1 - K0| / 4
+    double bound_window;                // duration of the bounds of the burst rates
+    std::vector<double> window_rise;    // largest exp(-t D1) - exp(-t d0), t in the window
+    std::vector<double> window_decay;   // exp(-bound_window D1)
+    std::vector<double> activations;    // interactions, inhibitions set to 0
+    std::vector<double> inhibitions;    // interactions, activations set to 0
+  };
+  /** PDMP engine of NG genes (0: any number), see Cancer.cpp */
+  template <int NG> class Pdmp;
+  /** Decays of the mRNA and proteins over a whole time-step dt, the same for
+   * all the cells (see BatchUpdate) */
+  struct StepDecay {
+    double dt = -1.;
+    double e0, e1_S, e1_D;
+  };
+  static StepDecay step_decay_;
+  static std::shared_ptr<const GeneParams> SharedGeneParams();
+  static std::shared_ptr<const GeneParams> ReadGeneParams();
+  static std::shared_ptr<const GeneParams> shared_gene_params_;
+
+  std::shared_ptr<const GeneParams> gene_params_;
+  const double* GenesInteractionsMatrix_;  // in gene_params_
+  const double* KinParam_;                 // in gene_params_
+  /** Pooled block holding all the arrays above (see AllocateArrays) */
+  void* arrays_block_ = nullptr;
   double* Remember_division_ ;
   int Number_Of_Genes_;
-  int Number_Of_Parameters_ = 15;
-  double Time_NextJump_ = 0.;
-  int ithGene_;
+  static constexpr int Number_Of_Parameters_ = 15;
+  // thinning of the bursts, see Cancer::Pdmp
+  double JumpHazard_ = -1.;  // unit exponential left before the next candidate (< 0: to draw)
+  double* KonBound_array_;   // bounds of the burst rates over the window
+  double BoundSignal_ = 0.;  // signal of gene 0 when its bound was computed
+  double BoundEnd_ = 0.;     // end of the window, from the start of the step
   std::vector<double>  phylogeny_t_;
   std::vector<int>  phylogeny_id_;
   const char phylogeny_T_filename[16] = "phylogeny_T.txt";
@@ -32,23 +32,62 @@
 #include <cstdlib>
 #include <cassert>
 
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
-
 
 
 // =================================================================
 //                    Definition of static attributes
 // =================================================================
-// The singleton instance
 Alea Alea::instance_;
+thread_local Alea::ScopedStream* Alea::current_stream_ = nullptr;
+
+namespace {
+// Philox4x32 multipliers and Weyl sequence increments
+constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+constexpr int kPhiloxRounds = 10;
+
+// Phase of the global stream, distinct from any phase used by ScopedStream
+constexpr uint32_t kGlobalPhase = 0xFFFFFFFF;
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                uint32_t out[4]) {
+  uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < kPhiloxRounds; round++) {
+    uint64_t p0 = static_cast<uint64_t>(kPhiloxM0) * c0;
+    uint64_t p1 = static_cast<uint64_t>(kPhiloxM1) * c2;
+    uint32_t hi0 = static_cast<uint32_t>(p0 >> 32), lo0 = static_cast<uint32_t>(p0);
+    uint32_t hi1 = static_cast<uint32_t>(p1 >> 32), lo1 = static_cast<uint32_t>(p1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+} // namespace
 
 
 // =================================================================
 //                             Constructors
 // =================================================================
-Alea::Alea(void) {
-  random_number_generator_ = gsl_rng_alloc(gsl_rng_default);
+Alea::Alea(void) : key_{0, 0}, global_stream_(kGlobalPhase) {
+}
+
+Alea::ScopedStream::ScopedStream(uint32_t stream_id, uint32_t timestep,
+                                 uint32_t phase) :
+    counter_{0, phase, timestep, stream_id},
+    previous_(current_stream_) {
+  current_stream_ = this;
+}
+
+Alea::ScopedStream::ScopedStream(uint32_t phase) :
+    counter_{0, phase, 0, 0},
+    previous_(nullptr) {
 }
 
 
@@ -56,7 +95,10 @@ Alea::Alea(void) {
 //                             Destructor
 // =================================================================
 Alea::~Alea(void) {
-  gsl_rng_free(random_number_generator_);
+}
+
+Alea::ScopedStream::~ScopedStream() {
+  if (current_stream_ == this) current_stream_ = previous_;
 }
 
 
@@ -64,27 +106,42 @@ Alea::~Alea(void) {
 //                            Public Methods
 // =================================================================
 void Alea::seed(int32_t seed) {
-  gsl_rng_set(instance_.random_number_generator_, (unsigned long int)seed);
+  instance_.key_[0] = static_cast<uint32_t>(seed);
+  instance_.key_[1] = 0;
+  instance_.global_stream_.counter_[0] = 0;
+  instance_.global_stream_.nb_buffered_ = 0;
 }
 
+// The global stream and the key are all there is to save: every other
+// stream is a function of the key and of its (stream id, timestep, phase)
 void Alea::Save(gzFile backup_file) const {
-  gzwrite(backup_file,
-          gsl_rng_state(random_number_generator_),
-          gsl_rng_size(random_number_generator_));
+  gzwrite(backup_file, key_, sizeof(key_));
+  gzwrite(backup_file, global_stream_.counter_, sizeof(global_stream_.counter_));
+  gzwrite(backup_file, global_stream_.buffer_, sizeof(global_stream_.buffer_));
+  gzwrite(backup_file, &global_stream_.nb_buffered_, sizeof(global_stream_.nb_buffered_));
 }
 
 void Alea::Load(gzFile backup_file) {
-  gzread(backup_file,
-         gsl_rng_state(random_number_generator_),
-         gsl_rng_size(random_number_generator_));
+  gzread(backup_file, key_, sizeof(key_));
+  gzread(backup_file, global_stream_.counter_, sizeof(global_stream_.counter_));
+  gzread(backup_file, global_stream_.buffer_, sizeof(global_stream_.buffer_));
+  gzread(backup_file, &global_stream_.nb_buffered_, sizeof(global_stream_.nb_buffered_));
 }
 
 void Alea::Save(FILE* backup_file) const {
-  assert(gsl_rng_fwrite(backup_file, random_number_generator_) == 0);
+  fwrite(key_, sizeof(key_), 1, backup_file);
+  fwrite(global_stream_.counter_, sizeof(global_stream_.counter_), 1, backup_file);
+  fwrite(global_stream_.buffer_, sizeof(global_stream_.buffer_), 1, backup_file);
+  fwrite(&global_stream_.nb_buffered_, sizeof(global_stream_.nb_buffered_), 1, backup_file);
 }
 
 void Alea::Load(FILE* backup_file) {
-  assert(gsl_rng_fread(backup_file, random_number_generator_) == 0);
+  size_t nb_read = 0;
+  nb_read += fread(key_, sizeof(key_), 1, backup_file);
+  nb_read += fread(global_stream_.counter_, sizeof(global_stream_.counter_), 1, backup_file);
+  nb_read += fread(global_stream_.buffer_, sizeof(global_stream_.buffer_), 1, backup_file);
+  nb_read += fread(&global_stream_.nb_buffered_, sizeof(global_stream_.nb_buffered_), 1, backup_file);
+  assert(nb_read == 4);
 }
 
 
@@ -93,6 +150,19 @@ void Alea::Load(FILE* backup_file) {
 // =================================================================
 //                           Protected Methods
 // =================================================================
+uint64_t Alea::random_bits(void) {
+  ScopedStream* stream = current_stream_ ? current_stream_
+                                         : &instance_.global_stream_;
+  if (stream->nb_buffered_ == 0) {
+    uint32_t block[4];
+    philox4x32(stream->counter_, instance_.key_, block);
+    stream->counter_[0]++;
+    stream->buffer_[0] = (static_cast<uint64_t>(block[0]) << 32) | block[1];
+    stream->buffer_[1] = (static_cast<uint64_t>(block[2]) << 32) | block[3];
+    stream->nb_buffered_ = 2;
+  }
+  return stream->buffer_[2 - stream->nb_buffered_--];
+}
 
 
 
@@ -31,9 +31,9 @@
 //                              Libraries
 // =================================================================
 #include <stdio.h>
+#include <cinttypes>
+#include <cmath>
 
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
 #include <zlib.h>
 
 
@@ -50,9 +50,44 @@
 // =================================================================
 
 
-
+/**
+ * Counter-based random number generator (Philox4x32-10).
+ *
+ * Every draw is a pure function of the seed and of a counter made of
+ * (stream id, timestep, phase, draw index). Each cell draws from its own
+ * stream while it is being updated (see ScopedStream), which makes results
+ * independent of the order in which cells are visited and of the number of
+ * threads. Draws made outside any ScopedStream (e.g. during setup) come from
+ * the global stream, which must only be used by one thread at a time.
+ */
 class Alea {
  public :
+  /**
+   * Selects the stream (stream_id, timestep, phase) for the draws made by the
+   * current thread as long as the object is in scope.
+   * Stream id 0 is reserved for the global stream.
+   */
+  class ScopedStream {
+   public:
+    ScopedStream(uint32_t stream_id, uint32_t timestep, uint32_t phase);
+    ScopedStream(const ScopedStream&) = delete;
+    ScopedStream& operator=(const ScopedStream&) = delete;
+    ~ScopedStream();
+
+   private:
+    friend class Alea;
+    /** Global stream: never made current, used as the fallback */
+    explicit ScopedStream(uint32_t phase);
+
+    /** Philox counter: draw block, phase, timestep, stream id */
+    uint32_t counter_[4];
+    /** Unused part of the last generated block */
+    uint64_t buffer_[2];
+    int8_t nb_buffered_ = 0;
+    /** Stream that was active before this one */
+    ScopedStream* previous_;
+  };
+
   // =================================================================
   //                        Singleton management
   // =================================================================
@@ -86,11 +121,14 @@ class Alea {
   static inline double random(void);
 
   /** Generates a Gaussian random number with 0 mean and unit variance
-   *  using polar form of the Box-Muller transformation */
+   *  using the Box-Muller transformation */
   static inline double gaussian_random(void);
+  /** Generates an exponential random number with mean param */
   static inline double exponential_random(double param);
-    static inline double gaussian_random_0_2(void);
-    static inline int discrete_distribution(int K, const double *P);
+  /** Generates a Gaussian random number with 0 mean and 0.2 std deviation */
+  static inline double gaussian_random_0_2(void);
+  /** Draws an index in [0, K) with (not necessarily normalized) weights P */
+  static inline int discrete_distribution(int K, const double *P);
 
   void Save(gzFile backup_file) const;
   void Load(gzFile backup_file);
@@ -106,11 +144,18 @@ class Alea {
   // =================================================================
   //                           Protected Methods
   // =================================================================
+  /** Next 64 random bits of the current stream */
+  static uint64_t random_bits(void);
 
   // =================================================================
   //                          Protected Attributes
   // =================================================================
-  gsl_rng* random_number_generator_;
+  /** Philox key, derived from the seed */
+  uint32_t key_[2];
+  /** Stream used when no ScopedStream is active */
+  ScopedStream global_stream_;
+  /** Stream currently selected by each thread */
+  static thread_local ScopedStream* current_stream_;
 };
 
 /*
@@ -118,34 +163,45 @@ class Alea {
  */
 int32_t Alea::random(int32_t max) {
   // Since max is an int32, it is safe to cast the result to an int32
-  return static_cast<int32_t>(gsl_rng_uniform_int(
-      instance_.random_number_generator_, (unsigned long int) max));
+  return static_cast<int32_t>(random() * max);
 };
 
 /*
  * Returns a pseudo-random double, uniform distribution in [0,1)
  */
 double Alea::random(void) {
-  return gsl_rng_uniform(instance_.random_number_generator_);
+  // 53 random bits make a uniformly distributed double-precision mantissa
+  return (random_bits() >> 11) * (1.0 / 9007199254740992.0);
 }
 
 
 double Alea::gaussian_random(void) {
-  return gsl_ran_gaussian(instance_.random_number_generator_, 1.0);
+  // u1 is taken in (0, 1] so that its log is finite
+  double u1 = 1.0 - random();
+  double u2 = random();
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
 }
 double Alea::exponential_random(double param) {
-  return gsl_ran_exponential(instance_.random_number_generator_, param);
+  return -param * log1p(-random());
 }
 
 
 double Alea::gaussian_random_0_2(void) {
-  return gsl_ran_gaussian(instance_.random_number_generator_, 0.2);
+  return 0.2 * gaussian_random();
 }
 
 int Alea::discrete_distribution(int K, const double *P) {
- gsl_ran_discrete_t* f = gsl_ran_discrete_preproc(K,P) ;
-  return gsl_ran_discrete(instance_.random_number_generator_,f);
+  double total = 0.0;
+  for (int k = 0; k < K; k++) total += P[k];
+
+  double u = random() * total;
+  double cumul = 0.0;
+  for (int k = 0; k < K - 1; k++) {
+    cumul += P[k];
+    if (u < cumul) return k;
   }
+  return K - 1;
+}
 
 
 #endif // SIMUSCALE_ALEA_H__
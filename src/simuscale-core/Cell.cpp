@@ -60,12 +60,18 @@ double Cell::LJ_epsilon_ = 0.002;
 Cell::Cell(const Cell &model) :
     Observable(),
     id_(maxID_++),
+    formalism_(model.formalism_),
     pos_(model.pos_),
     orientation_(model.orientation_),
     size_(model.size_),
     cell_type_(model.cell_type_),
     doubling_time_(model.doubling_time_),
     move_behaviour_(model.move_behaviour_) {
+  // A daughter cell starts with a copy of the ODE state of its mother
+  if (model.ode_store_ != nullptr) {
+    ode_store_ = model.ode_store_;
+    ode_lane_ = ode_store_->Acquire(model.ode_lane_);
+  }
 }
 
 Cell::Cell(CellType cell_type,
@@ -91,16 +97,39 @@ Cell::Cell(gzFile backup_file) : Cell() {
 // =================================================================
 //                             Destructor
 // =================================================================
+Cell::~Cell() {
+  if (ode_store_ != nullptr)
+    ode_store_->Release(ode_lane_);
+}
 
 // =================================================================
 //                            Public Methods
 // =================================================================
 void Cell::Update(const double& dt) {
   //std::cout << "CellUpdate"<< std::endl;
-  Move(dt);
+  ComputeUpdate(dt);
+  CommitUpdate();
+}
+
+void Cell::ComputeUpdate(const double& dt) {
+  ComputeMove(dt);
   InternalUpdate(dt);
 }
 
+void Cell::ComputeMove(const double& dt) {
+  // Neither the position nor the size of the cell are modified here, other
+  // cells may be reading them concurrently
+  next_displacement_ = move_behaviour_->Displacement(this, dt);
+  next_volume_ = size_.volume();
+}
+
+void Cell::CommitUpdate() {
+  if (move_behaviour_->type() != MoveBehaviour::Type::IMMOBILE) {
+    Move(next_displacement_);
+  }
+  size_.set_volume(next_volume_);
+}
+
 double Cell::Distance(const Cell* other) const {
   return (pos_ - other->pos_).norm();
 }
@@ -228,7 +257,8 @@ void Cell::Dump() {
               << "        \"type\": \"diffusive\",\n" 
               << "        \"targets\": [\n"; 
     auto n = get_diffusive_signal(signal).size(); 
-    auto ts = gaussian_field_targets(signal); // define ts to avoid dangling references
+    std::vector<Coordinates<double>> ts;
+    gaussian_field_targets(signal, ts);
     auto&& t = ts.begin();
     for ( auto val : get_diffusive_signal(signal) ) {
       std::cout << "          {\n";
@@ -274,15 +304,19 @@ Cell* Cell::MakeCell(CellFormalism formalism,
                      double initial_volume,
                      double volume_min,
                      double doubling_time) {
-  return factories().at(formalism)(type, move_behaviour,
-                                   pos, initial_volume, volume_min,
-                                   doubling_time);
+  Cell* cell = factories().at(formalism)(type, move_behaviour,
+                                         pos, initial_volume, volume_min,
+                                         doubling_time);
+  cell->formalism_ = formalism;
+  return cell;
 }
 
 Cell* Cell::LoadCell(gzFile backup_file) noexcept(false) {
   CellFormalism formalism;
   gzread(backup_file, &formalism, sizeof(formalism));
-  return loaders().at(formalism)(backup_file);
+  Cell* cell = loaders().at(formalism)(backup_file);
+  cell->formalism_ = formalism;
+  return cell;
 }
 
 /*
@@ -307,6 +341,28 @@ Cell::CellLoaders& Cell::loaders() {
   return *loaders;
 }
 
+/*
+ * Container for derived class batch updates
+ *
+ * NOTE: Use the "Construct On First Use Idiom" to avoid the
+ * "static initialization order fiasco"
+ */
+Cell::CellBatchUpdates& Cell::batch_updates() {
+  static CellBatchUpdates* batch_updates = new CellBatchUpdates();
+  return *batch_updates;
+}
+
+/*
+ * Container for derived class ODE right-hand sides
+ *
+ * NOTE: Use the "Construct On First Use Idiom" to avoid the
+ * "static initialization order fiasco"
+ */
+Cell::CellOdes& Cell::odes() {
+  static CellOdes* odes = new CellOdes();
+  return *odes;
+}
+
 void Cell::SaveStatic(gzFile backup_file) {
   gzwrite(backup_file, &maxID_, sizeof(maxID_));
 
@@ -346,22 +402,25 @@ void Cell::ComputeGaussianFields() {
 
   std::cerr << "Cell::ComputeGaussianFields. This methods is deprecated and should not be used." << std::endl;
    
+  std::vector<Coordinates<double>> targets;
   for ( unsigned long i = 0; i < nbr_signals; ++i) { 
-    intrinsic_inputs_.gaussian_field(static_cast<InterCellSignal>(i)).assign(gaussian_field_targets(static_cast<InterCellSignal>(i)).size(),0.0);
-    for (auto other : Simulation::pop().cell_list() ) {
+    gaussian_field_targets(static_cast<InterCellSignal>(i), targets);
+    std::vector<real_type> field(targets.size(), 0.0);
+    for (auto other : Simulation::pop().cells() ) {
       unsigned int j = 0;
-      for (auto target : gaussian_field_targets(static_cast<InterCellSignal>(i)) ) { 
+      for (auto target : targets ) { 
         // do something
         // target is a Coordinate
         const Coordinates<double>& source = other->gaussian_field_source(static_cast<InterCellSignal>(i));
         double  q = other->gaussian_field_weight(static_cast<InterCellSignal>(i));
-        intrinsic_inputs_.gaussian_field(static_cast<InterCellSignal>(i)).at(j) += 
+        field.at(j) += 
           q*exp((source.x - target.x)*(source.x - target.x))*\
             exp((source.y - target.y)*(source.y - target.y))*\
             exp((source.z - target.z)*(source.z - target.z));
         j++;
       }
     }
+    intrinsic_inputs_.AddGaussianField(static_cast<InterCellSignal>(i), field.data(), field.size());
   }
 }
 
@@ -432,7 +491,7 @@ void Cell::SeparateDividingCells(Cell* oldCell, Cell* newCell) {
 void Cell::Grow(const double& dt) {
   // Make cell grow
   growth_factor_ = pow(2, dt / doubling_time_);
-  size_.set_volume(size_.volume() * growth_factor_);
+  next_volume_ = size_.volume() * growth_factor_;
 
   // NB: cell division is controlled by both cell size and
   // the intracellular state (e.g. concentration of a certain kind of molecules)
@@ -527,8 +586,6 @@ double Cell::get_local_signal(InterCellSignal inSignal) const {
 
 
 void Cell::Move(Coordinates<double> dpos) {
-  Coordinates<double> old_pos = pos_;
-
   // If the movement in any of the (x, y or z) components would cause the
   // sphere defined by the internal radius of the cell to extend beyond
   // the world boundaries, cancel the movement in this component
@@ -536,15 +593,12 @@ void Cell::Move(Coordinates<double> dpos) {
 
   // Apply the movement
   pos_ += dpos;
-
-  // Inform observers
-  NotifyObservers(CELL_MOVED, &old_pos);
 }
 
 // FGT 
-void Cell::AddGaussianField(InterCellSignal signal, std::vector<real_type>& value) {
+void Cell::AddGaussianField(InterCellSignal signal, const real_type* value, size_t n) {
 
-  intrinsic_inputs_.AddGaussianField(signal, value);
+  intrinsic_inputs_.AddGaussianField(signal, value, n);
 
 }
 
@@ -562,27 +616,55 @@ const Coordinates<double>& Cell::gaussian_field_source(InterCellSignal signal) {
   return pos();
 }
 
-std::vector<Coordinates<double>> Cell::gaussian_field_targets(InterCellSignal signal) {
+void Cell::gaussian_field_targets(InterCellSignal signal,
+                                  std::vector<Coordinates<double>>& targets) {
 
   (void)signal;
-  std::vector<Coordinates<double>> targets;
+  targets.clear();
   targets.push_back(pos());
-  return targets;
 }
 
 
 bool Cell::RegisterClass(CellFormalism formalism,
                          const char param_file_keyword[],
                          CellFactory factory,
-                         CellLoader loader) {
+                         CellLoader loader,
+                         CellBatchUpdate batch_update) {
   SimulationParams::CellFormalisms()[param_file_keyword] = formalism;
   Cell::factories()[formalism] = factory;
   Cell::loaders()[formalism] = loader;
+  if (batch_update != nullptr)
+    Cell::batch_updates()[formalism] = batch_update;
+  return true;
+}
+
+Cell::CellBatchUpdate Cell::batch_update(CellFormalism formalism) {
+  auto batch_update = batch_updates().find(formalism);
+  return batch_update != batch_updates().end() ? batch_update->second : nullptr;
+}
+
+bool Cell::RegisterOde(CellFormalism formalism, OdeSolver::Rhs rhs) {
+  Cell::odes()[formalism] = rhs;
   return true;
 }
 
+OdeSolver::Rhs Cell::ode_rhs(CellFormalism formalism) {
+  auto ode = odes().find(formalism);
+  return ode != odes().end() ? ode->second : nullptr;
+}
+
+void Cell::InternalUpdates(Cell* const* cells, size_t nb_cells,
+                           const double& dt) {
+  #pragma omp parallel for schedule(dynamic) if (Simulation::threads() > 1)
+  for (size_t i = 0; i < nb_cells; ++i) {
+    Alea::ScopedStream stream(cells[i]->id(), Simulation::timestep(),
+                              Simulation::kInternalStream);
+    cells[i]->InternalUpdate(dt);
+  }
+}
+
 
-std::vector<real_type> Cell::get_diffusive_signal(InterCellSignal inSignal) const {
+const std::vector<real_type>& Cell::get_diffusive_signal(InterCellSignal inSignal) const {
   return intrinsic_inputs_.gaussian_field(inSignal);
 }
 
@@ -47,6 +47,9 @@
 #include "InterCellSignals.h"
 #include "CellSize.h"
 #include "movement/MoveBehaviour.h"
+#include "SlotMap.h"
+#include "MemoryPool.h"
+#include "OdeStore.h"
 
 // ============================================================================
 //                         Class declarations, Using etc
@@ -60,6 +63,9 @@ using real_type = InterCellSignals::real_type_;
 */
 class Cell : public Observable
 {
+  friend class MoveBehaviour;
+  friend class CellStore;
+  friend class Population;
   friend class Mobile;
   friend class Motile;
 
@@ -75,10 +81,26 @@ class Cell : public Observable
   using CellFactories = std::map<CellFormalism, CellFactory>;
   using CellLoader = Cell* (*)(gzFile backup_file);
   using CellLoaders = std::map<CellFormalism, CellLoader>;
+  /** Internal update of all the cells of a formalism for one time-step, in
+   * place of their InternalUpdate (see InternalUpdates for the contract) */
+  using CellBatchUpdate = void (*)(Cell* const* cells, size_t nb_cells,
+                                   const double& dt);
+  using CellBatchUpdates = std::map<CellFormalism, CellBatchUpdate>;
+  using CellOdes = std::map<CellFormalism, OdeSolver::Rhs>;
   static bool RegisterClass(CellFormalism formalism,
                             const char param_file_keyword[],
                             CellFactory factory,
-                            CellLoader loader);
+                            CellLoader loader,
+                            CellBatchUpdate batch_update = nullptr);
+  /** Batch update of the formalism, nullptr if it has none */
+  static CellBatchUpdate batch_update(CellFormalism formalism);
+  /** Register the right-hand side of the ODE system of the cells of a
+   * formalism. Its size and number of parameters are set in the param file
+   * (ODESYSTEMSIZE, ODENBPARAMS), the population integrates the systems of
+   * all the cells at each time-step (see OdeStore) */
+  static bool RegisterOde(CellFormalism formalism, OdeSolver::Rhs rhs);
+  /** Right-hand side of the ODE of the formalism, nullptr if it has none */
+  static OdeSolver::Rhs ode_rhs(CellFormalism formalism);
 
   // =================================================================
   //                             Constructors
@@ -96,7 +118,16 @@ class Cell : public Observable
   // =================================================================
   //                             Destructor
   // =================================================================
-  virtual ~Cell() = default;
+  virtual ~Cell();
+
+  // =================================================================
+  //                              Operators
+  // =================================================================
+  /** Cells of all formalisms are allocated from the MemoryPool */
+  static void* operator new(size_t size) { return MemoryPool::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) {
+    MemoryPool::Deallocate(ptr, size);
+  }
 
 
   // =================================================================
@@ -104,6 +135,17 @@ class Cell : public Observable
   // =================================================================
   /** \internal Update the cell. \endinternal */
   void Update(const double& dt);
+  /** \internal Compute the next state of the cell (displacement, volume and
+   * internal state) without changing what other cells can observe
+   * (position, size and type).
+   * \endinternal */
+  void ComputeUpdate(const double& dt);
+  /** \internal ComputeUpdate without the internal update, for the cells of
+   * the formalisms with a batch update. \endinternal */
+  void ComputeMove(const double& dt);
+  /** \internal Apply the displacement and volume change computed by
+   * ComputeUpdate. \endinternal */
+  void CommitUpdate();
 
   /** Distance between this cell and other cell.
    * @param dt the timestep
@@ -124,7 +166,7 @@ class Cell : public Observable
 
   void ComputeInteractions();
   void ComputeGaussianFields();
-  void AddGaussianField(InterCellSignal signal, std::vector<real_type>& value);
+  void AddGaussianField(InterCellSignal signal, const real_type* value, size_t n);
   void ResetInteractions();
   void Move(const double& dt);
 
@@ -171,6 +213,13 @@ class Cell : public Observable
   // =================================================================
   /** unique ID of the cell. */  
   int32_t id() const {return id_;};                         
+  /** Formalism of the cell (as registered with RegisterClass). */
+  CellFormalism formalism() const {return formalism_;};
+  /** Species i of the ODE system of the cell (see RegisterOde). */
+  double ode_state(uint32_t i) const {return ode_store_->y(ode_lane_, i);};
+  /** \internal index of the cell in the population's CellStore
+   * (valid during a time-step). \endinternal */
+  uint32_t store_index() const {return store_index_;};
   /** 3D coordinates of cell center. */
   const Coordinates<double>& pos() const {return pos_;};    
   /** x-coordinate of cell center. */
@@ -268,8 +317,10 @@ class Cell : public Observable
 
   /** The target locations of diffusive signal. 
    * @param signal the signal to express 
-   * @return the vector of coordinates of the targets for the diffusive signal */
-  virtual std::vector<Coordinates<double>>  gaussian_field_targets(InterCellSignal signal);
+   * @param targets filled with the coordinates of the targets for the
+   * diffusive signal (its capacity is reused from call to call) */
+  virtual void                              gaussian_field_targets(InterCellSignal signal,
+                                                                   std::vector<Coordinates<double>>& targets);
   // END Fast Gaussian Transform -------------------------------------
 
   /** The name of the cell formalism. */
@@ -284,6 +335,34 @@ class Cell : public Observable
    */
   virtual void InternalUpdate(const double& dt) = 0;
 
+  /** Set the initial state and parameters of the ODE system of a cell
+   * created from scratch, once it has joined the population (see
+   * RegisterOde). Daughter cells start with a copy of their mother's.
+   */
+  virtual void InitOde() {};
+
+  void set_ode_state(uint32_t i, double value) {
+    ode_store_->y(ode_lane_, i) = value;
+  }
+  /** Parameter i of the ODE system of the cell. The parameters can be
+   * changed in InternalUpdate, e.g. to follow the input signals: the ODE
+   * are integrated after the internal updates of the time-step. */
+  double ode_param(uint32_t i) const { return ode_store_->p(ode_lane_, i); }
+  void set_ode_param(uint32_t i, double value) {
+    ode_store_->p(ode_lane_, i) = value;
+  }
+
+  /** Call InternalUpdate on each of the nb_cells cells, in parallel.
+   *
+   * This is what a batch update (see CellBatchUpdate) must amount to. The
+   * cells are those of the formalism in the population, in id order; each
+   * of them must draw its random numbers from its internal update stream
+   * (see Simulation::kInternalStream) so that the result does not depend on
+   * how they are split between threads.
+   */
+  static void InternalUpdates(Cell* const* cells, size_t nb_cells,
+                              const double& dt);
+
   /** \internal Separate physically newly divided cells.
    * \endinternal
    */
@@ -291,6 +370,7 @@ class Cell : public Observable
 
   /** Increase the volume off cell with a
    * mean double time as set in parameter file.
+   * The new volume takes effect when the update is committed.
    */
   virtual void Grow(const double& dt); // Cell::Grow has a default behaviour
 
@@ -315,12 +395,18 @@ class Cell : public Observable
 
   /**
    * Add the visco-elastic force applied to this cell by other cell.
+   *
+   * During a simulation, this force is computed on the population's
+   * CellStore (see CellStore::ComputeMechForce).
    */
   virtual void AddMechForce(const Cell* other);
 
   /** \internal
    * Compute the biochemical action of other cell onto this
    * The signal is proportional to the surface of contact between the two cells
+   *
+   * During a simulation, this action is computed on the population's
+   * CellStore (see CellStore::ComputeChemInputs).
    * \endinternal
    */
   void AddChemCom(const Cell* other);
@@ -349,7 +435,7 @@ class Cell : public Observable
    * @return the sum of diffuse vales of inSignal by all cells at targets
    * @see local_signal
    */
-  std::vector<real_type> get_diffusive_signal(InterCellSignal inSignal) const;
+  const std::vector<real_type>& get_diffusive_signal(InterCellSignal inSignal) const;
 
 
  private:
@@ -367,6 +453,19 @@ class Cell : public Observable
   /** Cell ID */
   int32_t id_;
 
+  /** Cell formalism, set by the factories and copied at division */
+  CellFormalism formalism_ = 0;
+
+  /** Index in the population's CellStore */
+  uint32_t store_index_ = 0;
+
+  /** Handle of the cell in its population */
+  SlotMap<Cell*>::Handle population_handle_;
+
+  /** Store and lane of the ODE system of the cell, if its formalism has one */
+  OdeStore* ode_store_ = nullptr;
+  uint32_t ode_lane_ = 0;
+
   /** Coordinates in space */
   Coordinates<double> pos_;
 
@@ -402,6 +501,14 @@ class Cell : public Observable
    */
   Coordinates<double> mechanical_force_;
 
+  /** Displacement computed by ComputeUpdate, applied by CommitUpdate.
+   */
+  Coordinates<double> next_displacement_;
+
+  /** Volume computed by ComputeUpdate (see Grow), applied by CommitUpdate.
+   */
+  double next_volume_ = 0.0;
+
   /** Max mechanical force.
    */
   static double max_force_;
@@ -471,6 +578,22 @@ class Cell : public Observable
    * the actual "attribute" that can be used normaly, including as an lvalue
    */
   static CellLoaders& loaders();
+
+  /**
+   * Container for derived class batch updates
+   *
+   * This is a method for technical reasons only, it returns a reference to
+   * the actual "attribute" that can be used normaly, including as an lvalue
+   */
+  static CellBatchUpdates& batch_updates();
+
+  /**
+   * Container for derived class ODE right-hand sides
+   *
+   * This is a method for technical reasons only, it returns a reference to
+   * the actual "attribute" that can be used normaly, including as an lvalue
+   */
+  static CellOdes& odes();
 };
 
 #endif // SIMUSCALE_CELL_H__
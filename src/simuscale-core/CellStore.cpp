@@ -0,0 +1,267 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "CellStore.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "Cell.h"
+#include "ContactKernel.h"
+#include "Simulation.h"
+#include "movement/MoveBehaviour.h"
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+void CellStore::Gather(const SlotMap<Cell*>& cells) {
+  cells_.assign(cells.begin(), cells.end());
+
+  const uint32_t nb_cells = size();
+  // Candidate lists refer to store indices, they can only be reused if the
+  // cells are the same, in the same order
+  if (id_.size() != nb_cells) candidates_built_ = false;
+  id_.resize(nb_cells);
+  x_.resize(nb_cells);
+  y_.resize(nb_cells);
+  z_.resize(nb_cells);
+  internal_radius_.resize(nb_cells);
+  external_radius_.resize(nb_cells);
+  fx_.resize(nb_cells);
+  fy_.resize(nb_cells);
+  fz_.resize(nb_cells);
+  type_.resize(nb_cells);
+  mobile_.resize(nb_cells);
+  // Neighbour lists are only ever cleared, their capacity is kept from one
+  // time-step to the next
+  if (neighbours_.size() < nb_cells) neighbours_.resize(nb_cells);
+  if (candidates_.size() < nb_cells) candidates_.resize(nb_cells);
+  if (incidence_.size() < nb_cells) incidence_.resize(nb_cells);
+  signals_.resize(static_cast<size_t>(nb_cells) * nbr_signals);
+  inputs_.resize(static_cast<size_t>(nb_cells) * nbr_signals);
+
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    Cell* cell = cells_[i];
+    cell->store_index_ = i;
+    if (id_[i] != cell->id_) {
+      id_[i] = cell->id_;
+      candidates_built_ = false;
+    }
+    x_[i] = cell->pos_.x;
+    y_[i] = cell->pos_.y;
+    z_[i] = cell->pos_.z;
+    internal_radius_[i] = cell->internal_radius();
+    external_radius_[i] = cell->external_radius();
+    type_[i] = cell->cell_type_;
+    mobile_[i] = cell->move_behaviour_->type() != MoveBehaviour::Type::IMMOBILE;
+  }
+}
+
+void CellStore::SortCandidates(uint32_t i) {
+  std::sort(candidates_[i].begin(), candidates_[i].end());
+}
+
+void CellStore::CandidatesBuilt(double skin) {
+  candidates_x_ = x_;
+  candidates_y_ = y_;
+  candidates_z_ = z_;
+  candidates_radius_ = external_radius_;
+  candidates_skin_ = skin;
+  candidates_built_ = true;
+}
+
+/*
+ * Two cells i and j that are not candidates of each other were at least
+ * r_i + r_j + skin apart. They can only be in contact if their displacements
+ * plus the growth of their radii add up to more than the skin, which cannot
+ * happen while each cell has drifted by less than half the skin
+ */
+bool CellStore::CandidatesValid() const {
+  if (not candidates_built_ or candidates_skin_ <= 0.0) return false;
+
+  double max_drift = 0.0;
+  for (uint32_t i = 0; i < size(); ++i) {
+    double dx = x_[i] - candidates_x_[i];
+    double dy = y_[i] - candidates_y_[i];
+    double dz = z_[i] - candidates_z_[i];
+    double drift = sqrt(dx*dx + dy*dy + dz*dz) +
+        std::max(0.0, external_radius_[i] - candidates_radius_[i]);
+    max_drift = std::max(max_drift, drift);
+  }
+
+  return 2.0 * max_drift < candidates_skin_;
+}
+
+void CellStore::SelectNeighbours(uint32_t i) {
+  neighbours_[i].clear();
+  for (uint32_t j : candidates_[i]) {
+    if (Distance(i, j) < external_radius_[j] + external_radius_[i]) {
+      neighbours_[i].push_back(j);
+    }
+  }
+}
+
+/*
+ * Neighbourhood is symmetric: a pair (i, j) is created when visiting the
+ * neighbours of i, the smallest index. Cells are visited in store order and
+ * neighbour lists are sorted, so the pairs are added to the incidence list of
+ * each cell in the order of its neighbours
+ */
+void CellStore::BuildPairs() {
+  pair_i_.clear();
+  pair_j_.clear();
+  for (uint32_t i = 0; i < size(); ++i) {
+    incidence_[i].clear();
+  }
+
+  for (uint32_t i = 0; i < size(); ++i) {
+    for (uint32_t j : neighbours_[i]) {
+      if (j < i) continue;
+      uint32_t p = nb_pairs();
+      pair_i_.push_back(i);
+      pair_j_.push_back(j);
+      incidence_[i].push_back(p);
+      incidence_[j].push_back(p);
+    }
+  }
+
+  pair_dx_.resize(nb_pairs());
+  pair_dy_.resize(nb_pairs());
+  pair_dz_.resize(nb_pairs());
+  pair_r_.resize(nb_pairs());
+  pair_sigma_.resize(nb_pairs());
+  pair_fx_.resize(nb_pairs());
+  pair_fy_.resize(nb_pairs());
+  pair_fz_.resize(nb_pairs());
+  pair_area_.resize(nb_pairs());
+  pair_touching_.resize(nb_pairs());
+}
+
+/*
+ * Same capped Lennard-Jones force as Cell::AddMechForce (see ContactKernel)
+ * and same contact area as Cell::AddChemCom
+ */
+void CellStore::ComputePairs(uint32_t begin, uint32_t end) {
+  static constexpr double LJFACTOR = 1.122462048309373;
+
+  // Pack the geometry of the pairs
+  for (uint32_t p = begin; p < end; ++p) {
+    const uint32_t i = pair_i_[p];
+    const uint32_t j = pair_j_[p];
+    pair_dx_[p] = x_[j] - x_[i];
+    pair_dy_[p] = y_[j] - y_[i];
+    pair_dz_[p] = z_[j] - z_[i];
+    pair_r_[p] = Distance(i, j);
+    pair_sigma_[p] = (internal_radius_[j] + internal_radius_[i]) / LJFACTOR;
+
+    // Surface of contact
+    double mean_radius = (external_radius_[j] + external_radius_[i]) / 2.;
+    double h = mean_radius - pair_r_[p] / 2.;
+    pair_touching_[p] = h > 0;
+    pair_area_[p] = Simulation::usecontactarea() ?
+                    M_PI * (mean_radius * h - h*h / 4) : 1.0;
+  }
+
+  ContactKernel::ComputeForces(end - begin,
+                               &pair_dx_[begin], &pair_dy_[begin],
+                               &pair_dz_[begin], &pair_r_[begin],
+                               &pair_sigma_[begin],
+                               Cell::LJ_epsilon_, Cell::max_force_,
+                               &pair_fx_[begin], &pair_fy_[begin],
+                               &pair_fz_[begin]);
+}
+
+void CellStore::GatherSignals(uint32_t i) {
+  double* signals = &signals_[static_cast<size_t>(i) * nbr_signals];
+  for (unsigned long s = 0; s < nbr_signals; ++s) {
+    signals[s] = cells_[i]->local_signal(static_cast<InterCellSignal>(s));
+  }
+}
+
+/*
+ * Sum of the forces of the pairs the i-th cell belongs to
+ */
+void CellStore::ComputeMechForce(uint32_t i) {
+  double fx = 0.0, fy = 0.0, fz = 0.0;
+
+  /// don't move NICHE or other IMMOBILE cells
+  if (mobile_[i]) {
+    for (uint32_t p : incidence_[i]) {
+      if (pair_i_[p] == i) {
+        fx += pair_fx_[p];
+        fy += pair_fy_[p];
+        fz += pair_fz_[p];
+      }
+      else {
+        fx -= pair_fx_[p];
+        fy -= pair_fy_[p];
+        fz -= pair_fz_[p];
+      }
+    }
+  }
+
+  fx_[i] = fx;
+  fy_[i] = fy;
+  fz_[i] = fz;
+}
+
+void CellStore::ScatterMechForce(uint32_t i) const {
+  Coordinates<double>& force = cells_[i]->mechanical_force_;
+  force.x = fx_[i];
+  force.y = fy_[i];
+  force.z = fz_[i];
+  force.assert_no_nan();
+}
+
+void CellStore::ComputeChemInputs(uint32_t i) {
+  double* inputs = &inputs_[static_cast<size_t>(i) * nbr_signals];
+  std::fill(inputs, inputs + nbr_signals, 0.0);
+
+  for (uint32_t p : incidence_[i]) {
+    // No communication if cells are not touching
+    if (not pair_touching_[p]) continue;
+
+    uint32_t j = (pair_i_[p] == i) ? pair_j_[p] : pair_i_[p];
+    const double* signals = &signals_[static_cast<size_t>(j) * nbr_signals];
+    for (unsigned long s = 0; s < nbr_signals; ++s) {
+      inputs[s] += pair_area_[p] * signals[s];
+    }
+    // This signal is either on or off
+    if (type_[j] == NICHE) {
+      inputs[static_cast<int>(InterCellSignal::NICHE)] += 1.;
+    }
+  }
+
+  Cell* cell = cells_[i];
+  cell->ResetInSignals();
+  for (unsigned long s = 0; s < nbr_signals; ++s) {
+    cell->intrinsic_inputs_.Add(static_cast<InterCellSignal>(s), inputs[s]);
+  }
+}
@@ -0,0 +1,194 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_CELLSTORE_H__
+#define SIMUSCALE_CELLSTORE_H__
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cinttypes>
+#include <cmath>
+
+#include <vector>
+
+#include "CellType.h"
+#include "Coordinates.h"
+#include "InterCellSignal.h"
+#include "SlotMap.h"
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+class Cell;
+
+
+/*!
+  \brief Contiguous (struct-of-arrays) copy of the physical state of the
+  cells of a population.
+
+  The store is gathered from the cells at the beginning of each time-step.
+  Neighbour search and interactions run on its arrays, the resulting forces
+  and input signals are then scattered back to the cells. Each cell knows its
+  index in the store (Cell::store_index).
+
+  Interactions are computed once per pair of neighbours (i < j), each cell
+  then sums the contributions of the pairs it belongs to in the order of its
+  neighbour list.
+*/
+class CellStore {
+ public :
+  // =================================================================
+  //                             Constructors
+  // =================================================================
+  CellStore(void) = default;
+  CellStore(const CellStore &model) = delete;
+
+  // =================================================================
+  //                             Destructor
+  // =================================================================
+  virtual ~CellStore(void) = default;
+
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Copy the physical state of cells into the store, in population order */
+  void Gather(const SlotMap<Cell*>& cells);
+
+  /** Empty the candidate neighbour list of the i-th cell */
+  void ResetCandidates(uint32_t i) { candidates_[i].clear(); }
+  /** Add the j-th cell to the candidate neighbours of the i-th cell */
+  void AddCandidate(uint32_t i, uint32_t j) { candidates_[i].push_back(j); }
+  /** Put the candidates of the i-th cell in store order */
+  void SortCandidates(uint32_t i);
+  /** Record the positions and radii the candidate lists were built from */
+  void CandidatesBuilt(double skin);
+  /** Whether the candidate lists still contain every cell that can be in
+   * contact with their owner, i.e. no cell has moved or grown by more than
+   * half the skin since they were built and the population is unchanged */
+  bool CandidatesValid() const;
+  /** Keep in the neighbours of the i-th cell the candidates it touches */
+  void SelectNeighbours(uint32_t i);
+
+  /** Distance between the centres of the i-th and j-th cells */
+  double Distance(uint32_t i, uint32_t j) const {
+    double dx = x_[i] - x_[j];
+    double dy = y_[i] - y_[j];
+    double dz = z_[i] - z_[j];
+    return sqrt(dx*dx + dy*dy + dz*dz);
+  }
+
+  /** List the pairs of neighbours and the pairs each cell belongs to */
+  void BuildPairs();
+  /** Compute the force and the contact area of the pairs begin to end - 1 */
+  void ComputePairs(uint32_t begin, uint32_t end);
+  /** Copy the signals emitted by the i-th cell */
+  void GatherSignals(uint32_t i);
+
+  /** Compute the force exerted on the i-th cell by its neighbours */
+  void ComputeMechForce(uint32_t i);
+  /** Set the mechanical force of the i-th cell to the one computed here */
+  void ScatterMechForce(uint32_t i) const;
+  /** Compute the signals received by the i-th cell from its neighbours and
+   * set its input signals to them */
+  void ComputeChemInputs(uint32_t i);
+
+  // =================================================================
+  //                              Accessors
+  // =================================================================
+  uint32_t size() const { return static_cast<uint32_t>(cells_.size()); }
+  Cell* cell(uint32_t i) const { return cells_[i]; }
+  const std::vector<Cell*>& cells() const { return cells_; }
+  Coordinates<double> pos(uint32_t i) const {
+    return Coordinates<double>(x_[i], y_[i], z_[i]);
+  }
+  const std::vector<double>& x() const { return x_; }
+  const std::vector<double>& y() const { return y_; }
+  const std::vector<double>& z() const { return z_; }
+  const std::vector<double>& internal_radius() const { return internal_radius_; }
+  const std::vector<double>& external_radius() const { return external_radius_; }
+  const std::vector<CellType>& type() const { return type_; }
+  const std::vector<uint32_t>& neighbours(uint32_t i) const { return neighbours_[i]; }
+  uint32_t nb_pairs() const { return static_cast<uint32_t>(pair_i_.size()); }
+
+ protected :
+  // =================================================================
+  //                              Attributes
+  // =================================================================
+  std::vector<Cell*> cells_;
+
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+  std::vector<double> internal_radius_;
+  std::vector<double> external_radius_;
+  std::vector<double> fx_;
+  std::vector<double> fy_;
+  std::vector<double> fz_;
+  std::vector<CellType> type_;
+  /** Whether the cell is subject to mechanical forces (i.e. not IMMOBILE) */
+  std::vector<uint8_t> mobile_;
+  std::vector<int32_t> id_;
+
+  /** Indices of the neighbours of each cell, in store order */
+  std::vector<std::vector<uint32_t>> neighbours_;
+
+  /** Indices of the cells that were closer than the sum of the external
+   * radii plus the skin when the lists were built (Verlet lists) */
+  std::vector<std::vector<uint32_t>> candidates_;
+  bool candidates_built_ = false;
+  double candidates_skin_ = 0.0;
+  /** Positions and external radii at the time the candidates were built */
+  std::vector<double> candidates_x_;
+  std::vector<double> candidates_y_;
+  std::vector<double> candidates_z_;
+  std::vector<double> candidates_radius_;
+
+  /** Pairs of neighbours (pair_i_ < pair_j_) */
+  std::vector<uint32_t> pair_i_;
+  std::vector<uint32_t> pair_j_;
+  /** Geometry of the pair: vector from pair_i_ to pair_j_, its norm and the
+   * Lennard-Jones sigma */
+  std::vector<double> pair_dx_;
+  std::vector<double> pair_dy_;
+  std::vector<double> pair_dz_;
+  std::vector<double> pair_r_;
+  std::vector<double> pair_sigma_;
+  /** Force exerted on pair_i_ by pair_j_ (the opposite on pair_j_) */
+  std::vector<double> pair_fx_;
+  std::vector<double> pair_fy_;
+  std::vector<double> pair_fz_;
+  /** Contact area of the pair, only meaningful if the cells touch */
+  std::vector<double> pair_area_;
+  std::vector<uint8_t> pair_touching_;
+  /** Pairs each cell belongs to, in the order of its neighbours */
+  std::vector<std::vector<uint32_t>> incidence_;
+
+  /** Signals emitted and received by each cell (nbr_signals per cell) */
+  std::vector<double> signals_;
+  std::vector<double> inputs_;
+};
+
+#endif // SIMUSCALE_CELLSTORE_H__
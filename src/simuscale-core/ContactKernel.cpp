@@ -0,0 +1,162 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "ContactKernel.h"
+
+#include <cassert>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMUSCALE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+// =================================================================
+//                           Static functions
+// =================================================================
+namespace {
+
+/*
+ * Reference path, the SIMD ones below must perform the same operations in
+ * the same order
+ */
+void ComputeForcesScalar(size_t begin, size_t n,
+                         const double* dx, const double* dy,
+                         const double* dz, const double* r,
+                         const double* sigma,
+                         double epsilon, double max_force,
+                         double* fx, double* fy, double* fz) {
+  const double factor = -24.0 * epsilon;
+  for (size_t k = begin; k < n; ++k) {
+    double inv_r = 1.0 / r[k];
+    double s = sigma[k] * inv_r;
+    double s2 = s * s;
+    double s6 = s2 * s2 * s2;
+    double s12 = s6 * s6;
+    double force = factor * ((s12 + s12) - s6) * inv_r;
+    force = std::min(std::max(force, -max_force), max_force);
+    double scale = force * inv_r;
+    fx[k] = scale * dx[k];
+    fy[k] = scale * dy[k];
+    fz[k] = scale * dz[k];
+  }
+}
+
+#ifdef SIMUSCALE_X86_SIMD
+// No FMA: contracting the multiplications and additions would give results
+// that differ from the scalar path
+__attribute__((target("avx2")))
+size_t ComputeForcesAvx2(size_t n,
+                         const double* dx, const double* dy,
+                         const double* dz, const double* r,
+                         const double* sigma,
+                         double epsilon, double max_force,
+                         double* fx, double* fy, double* fz) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d factor = _mm256_set1_pd(-24.0 * epsilon);
+  const __m256d max_f = _mm256_set1_pd(max_force);
+  const __m256d min_f = _mm256_set1_pd(-max_force);
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    __m256d inv_r = _mm256_div_pd(one, _mm256_loadu_pd(r + k));
+    __m256d s = _mm256_mul_pd(_mm256_loadu_pd(sigma + k), inv_r);
+    __m256d s2 = _mm256_mul_pd(s, s);
+    __m256d s6 = _mm256_mul_pd(_mm256_mul_pd(s2, s2), s2);
+    __m256d s12 = _mm256_mul_pd(s6, s6);
+    __m256d force = _mm256_mul_pd(
+        _mm256_mul_pd(factor, _mm256_sub_pd(_mm256_add_pd(s12, s12), s6)),
+        inv_r);
+    force = _mm256_min_pd(_mm256_max_pd(force, min_f), max_f);
+    __m256d scale = _mm256_mul_pd(force, inv_r);
+    _mm256_storeu_pd(fx + k, _mm256_mul_pd(scale, _mm256_loadu_pd(dx + k)));
+    _mm256_storeu_pd(fy + k, _mm256_mul_pd(scale, _mm256_loadu_pd(dy + k)));
+    _mm256_storeu_pd(fz + k, _mm256_mul_pd(scale, _mm256_loadu_pd(dz + k)));
+  }
+  return k;
+}
+
+__attribute__((target("avx512f")))
+size_t ComputeForcesAvx512(size_t n,
+                           const double* dx, const double* dy,
+                           const double* dz, const double* r,
+                           const double* sigma,
+                           double epsilon, double max_force,
+                           double* fx, double* fy, double* fz) {
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d factor = _mm512_set1_pd(-24.0 * epsilon);
+  const __m512d max_f = _mm512_set1_pd(max_force);
+  const __m512d min_f = _mm512_set1_pd(-max_force);
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    __m512d inv_r = _mm512_div_pd(one, _mm512_loadu_pd(r + k));
+    __m512d s = _mm512_mul_pd(_mm512_loadu_pd(sigma + k), inv_r);
+    __m512d s2 = _mm512_mul_pd(s, s);
+    __m512d s6 = _mm512_mul_pd(_mm512_mul_pd(s2, s2), s2);
+    __m512d s12 = _mm512_mul_pd(s6, s6);
+    __m512d force = _mm512_mul_pd(
+        _mm512_mul_pd(factor, _mm512_sub_pd(_mm512_add_pd(s12, s12), s6)),
+        inv_r);
+    force = _mm512_min_pd(_mm512_max_pd(force, min_f), max_f);
+    __m512d scale = _mm512_mul_pd(force, inv_r);
+    _mm512_storeu_pd(fx + k, _mm512_mul_pd(scale, _mm512_loadu_pd(dx + k)));
+    _mm512_storeu_pd(fy + k, _mm512_mul_pd(scale, _mm512_loadu_pd(dy + k)));
+    _mm512_storeu_pd(fz + k, _mm512_mul_pd(scale, _mm512_loadu_pd(dz + k)));
+  }
+  return k;
+}
+#endif // SIMUSCALE_X86_SIMD
+
+} // namespace
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+void ContactKernel::ComputeForces(Simd::Isa isa, size_t n,
+                                  const double* dx, const double* dy,
+                                  const double* dz, const double* r,
+                                  const double* sigma,
+                                  double epsilon, double max_force,
+                                  double* fx, double* fy, double* fz) {
+  assert(Simd::Supports(isa));
+
+  // Vector paths process whole vectors, the remainder is done in scalar
+  size_t done = 0;
+#ifdef SIMUSCALE_X86_SIMD
+  if (isa == Simd::Isa::AVX512)
+    done = ComputeForcesAvx512(n, dx, dy, dz, r, sigma, epsilon, max_force,
+                               fx, fy, fz);
+  else if (isa == Simd::Isa::AVX2)
+    done = ComputeForcesAvx2(n, dx, dy, dz, r, sigma, epsilon, max_force,
+                             fx, fy, fz);
+#endif
+  ComputeForcesScalar(done, n, dx, dy, dz, r, sigma, epsilon, max_force,
+                      fx, fy, fz);
+}
@@ -0,0 +1,84 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_CONTACTKERNEL_H__
+#define SIMUSCALE_CONTACTKERNEL_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cstddef>
+
+#include "Simd.h"
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Capped Lennard-Jones contact force over packed arrays of pairs.
+
+  For each pair, given the vector (dx, dy, dz) from the first cell to the
+  second one, its norm r and sigma = (R_int1 + R_int2) / 2^(1/6), the force
+  exerted on the first cell is
+
+    f = -24 epsilon (2 sigma^12 / r^13 - sigma^6 / r^7) (dx, dy, dz) / r
+
+  its magnitude clipped to max_force. Powers are computed by multiplication.
+
+  The AVX2 and AVX-512 paths perform the very same IEEE operations as the
+  scalar one, lane by lane, so that the result does not depend on the path
+  used. The fastest path supported by the CPU is used by default (see Simd).
+*/
+class ContactKernel {
+ public :
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Compute the forces of n pairs with the fastest available path */
+  static void ComputeForces(size_t n,
+                            const double* dx, const double* dy,
+                            const double* dz, const double* r,
+                            const double* sigma,
+                            double epsilon, double max_force,
+                            double* fx, double* fy, double* fz) {
+    ComputeForces(Simd::isa(), n, dx, dy, dz, r, sigma, epsilon, max_force,
+                  fx, fy, fz);
+  }
+  /** Compute the forces of n pairs with the given path, which must be
+   * supported (see Simd::Supports) */
+  static void ComputeForces(Simd::Isa isa, size_t n,
+                            const double* dx, const double* dy,
+                            const double* dz, const double* r,
+                            const double* sigma,
+                            double epsilon, double max_force,
+                            double* fx, double* fy, double* fz);
+};
+
+#endif // SIMUSCALE_CONTACTKERNEL_H__
@@ -35,10 +35,9 @@
 #include <cassert>
 
 #include <algorithm>
-#include <functional>
 #include <iostream>
 
-#include "Coordinates.h"
+#include "CellStore.h"
 
 using std::cout;
 using std::endl;
@@ -48,6 +47,7 @@ using std::endl;
 // =================================================================
 //                    Definition of static attributes
 // =================================================================
+constexpr uint64_t Grid::kNoKey;
 
 // =================================================================
 //                             Constructors
@@ -65,117 +65,126 @@ Grid::~Grid() = default;
 //                            Public Methods
 // =================================================================
 void Grid::print() {
-  for(int32_t x=0; x < kNbVoxels; x++)
-    for(int32_t y = 0; y < kNbVoxels; y++)
-      for(int32_t z = 0; z < kNbVoxels; z++)
-        if (! (cells_[x][y][z].empty()))
-          cout << "There are " << cells_[x][y][z].size() <<
-              "cells in voxel (" << x << ", " << y << ", " << z << ")" << endl;
+  for (uint32_t v = 0; v < voxel_keys_.size(); ++v) {
+    uint32_t nb_cells = cell_start_[v + 1] - cell_start_[v];
+    if (nb_cells > 0) {
+      uint64_t key = voxel_keys_[v];
+      cout << "There are " << nb_cells <<
+          "cells in voxel (" << static_cast<int16_t>(key >> 32) << ", " <<
+          static_cast<int16_t>(key >> 16) << ", " <<
+          static_cast<int16_t>(key) << ")" << endl;
+    }
+  }
 }
 
-/**
- * Called whenever an observed object notifies us
- *
- * Here when a cell has moved
- */
-void Grid::Update(Observable& o, ObservableEvent e, void* arg) {
-  assert(e == CELL_MOVED);
-  MoveCell(static_cast<Cell*>(&o), *static_cast<Coordinates<double>*>(arg));
-}
+void Grid::Rebuild(const CellStore& store) {
+  const uint32_t nb_cells = store.size();
 
-void Grid::MoveCell(Cell* cell, Coordinates<double>& old_pos) {
-  // Update grid if there was a movement
-  Coordinates<int16_t> newGridCoords{
-      static_cast<int16_t>(floor(cell->pos_x() / kVoxelSize)),
-      static_cast<int16_t>(floor(cell->pos_y() / kVoxelSize)),
-      static_cast<int16_t>(floor(cell->pos_z() / kVoxelSize))
-  };
-  Coordinates<int16_t> oldGridCoords{
-      static_cast<int16_t>(floor(old_pos.x / kVoxelSize)),
-      static_cast<int16_t>(floor(old_pos.y / kVoxelSize)),
-      static_cast<int16_t>(floor(old_pos.z / kVoxelSize))
-  };
-  assert((newGridCoords.x >= 0) && (newGridCoords.x < kNbVoxels));
-  assert((newGridCoords.y >= 0) && (newGridCoords.y < kNbVoxels));
-  assert((newGridCoords.z >= 0) && (newGridCoords.z < kNbVoxels));
-
-  // Change voxel the cell is in
-  if (newGridCoords != oldGridCoords) {
-    list<Cell*>& oldList =
-        cells_[oldGridCoords.x][oldGridCoords.y][oldGridCoords.z];
-    list<Cell*>& newList =
-        cells_[newGridCoords.x][newGridCoords.y][newGridCoords.z];
-
-    // Move cell from oldList to newList
-    list<Cell*>::iterator it = find(oldList.begin(), oldList.end(), cell);
-    // If the cell is not in the list, it's a new cell that has not been placed
-    // on the grid yet => nothing to do
-    if (it == oldList.end()) return;
-
-    // Actually move cell from oldList to newList
-    newList.splice(newList.end(), oldList, it);
-
-    // Sort the list of cells in the "new" voxel
-    newList.sort([] (Cell* first, Cell* second) {
-        return first->id() < second->id();
-    });
+  // Forget the voxels that cells have left long ago
+  if (voxel_keys_.size() > 8 * static_cast<size_t>(nb_cells) + 1024) {
+    ClearVoxels();
   }
-}
 
-void Grid::RemoveCell(Cell* cell) {
-  auto cellCoords = GridCoords(cell->pos());
-  cells_[cellCoords.x][cellCoords.y][cellCoords.z].remove(cell);
-}
+  // Find the voxel of each cell
+  cell_voxel_.resize(nb_cells);
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    cell_voxel_[i] = FindOrAddVoxel(Key(GridCoords(store.pos(i))));
+  }
 
-void Grid::AddCell(Cell* cell) {
-  Coordinates<int16_t> gridCoords{
-      static_cast<int16_t>(floor(cell->pos_x() / kVoxelSize)),
-      static_cast<int16_t>(floor(cell->pos_y() / kVoxelSize)),
-      static_cast<int16_t>(floor(cell->pos_z() / kVoxelSize))
-  };
-  assert((gridCoords.x >= 0) && (gridCoords.x < kNbVoxels));
-  assert((gridCoords.y >= 0) && (gridCoords.y < kNbVoxels));
-  assert((gridCoords.z >= 0) && (gridCoords.z < kNbVoxels));
-  cells_[gridCoords.x][gridCoords.y][gridCoords.z].push_back(cell);
-
-  // Subscribe as an observer of the cell
-  cell->AddObserver(this, CELL_MOVED);
+  // Counting sort of the cells by voxel. It is stable, the cells of each
+  // voxel are in store order
+  const uint32_t nb_voxels = static_cast<uint32_t>(voxel_keys_.size());
+  cell_start_.assign(nb_voxels + 1, 0);
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    cell_start_[cell_voxel_[i] + 1]++;
+  }
+  for (uint32_t v = 0; v < nb_voxels; ++v) {
+    cell_start_[v + 1] += cell_start_[v];
+  }
+  cursor_.assign(cell_start_.begin(), cell_start_.end() - 1);
+  cell_index_.resize(nb_cells);
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    cell_index_[cursor_[cell_voxel_[i]]++] = i;
+  }
 }
 
-void Grid::Save(gzFile) const {
+void Grid::Save(gzFile backup_file) const {
+  gzwrite(backup_file, &voxel_size_, sizeof(voxel_size_));
 }
 
-void Grid::Load(gzFile) {
+void Grid::Load(gzFile backup_file) {
+  gzread(backup_file, &voxel_size_, sizeof(voxel_size_));
 }
 
 
 // =================================================================
 //                           Protected Methods
 // =================================================================
+size_t Grid::Slot(uint64_t key) const {
+  // Fibonacci hashing, the table size is a power of 2
+  size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 20);
+  const size_t mask = table_keys_.size() - 1;
+  for (slot &= mask; table_keys_[slot] != key and table_keys_[slot] != kNoKey;
+       slot = (slot + 1) & mask);
+  return slot;
+}
+
+int32_t Grid::FindVoxel(uint64_t key) const {
+  if (table_keys_.empty()) return -1;
+  size_t slot = Slot(key);
+  return (table_keys_[slot] == key) ? static_cast<int32_t>(table_voxels_[slot])
+                                    : -1;
+}
+
+uint32_t Grid::FindOrAddVoxel(uint64_t key) {
+  // Grow the table (and re-insert all the voxels) when it gets half full
+  if (2 * (voxel_keys_.size() + 1) > table_keys_.size()) {
+    size_t new_size = std::max<size_t>(1024, 2 * table_keys_.size());
+    table_keys_.assign(new_size, kNoKey);
+    table_voxels_.assign(new_size, 0);
+    for (uint32_t v = 0; v < voxel_keys_.size(); ++v) {
+      size_t slot = Slot(voxel_keys_[v]);
+      table_keys_[slot] = voxel_keys_[v];
+      table_voxels_[slot] = v;
+    }
+  }
 
+  size_t slot = Slot(key);
+  if (table_keys_[slot] != key) {
+    table_keys_[slot] = key;
+    table_voxels_[slot] = static_cast<uint32_t>(voxel_keys_.size());
+    voxel_keys_.push_back(key);
+  }
+  return table_voxels_[slot];
+}
 
+void Grid::ClearVoxels() {
+  voxel_keys_.clear();
+  std::fill(table_keys_.begin(), table_keys_.end(), kNoKey);
+}
 
 
 
 // =================================================================
 //                          Non inline accessors
 // =================================================================
-list<Cell*>& Grid::getCellsInVoxel(Coordinates<int16_t> gridCoords) {
-  assert (gridCoords.x >= 0 and gridCoords.x <= kNbVoxels and
-          gridCoords.y >= 0 and gridCoords.y <= kNbVoxels and
-          gridCoords.z >= 0 and gridCoords.z <= kNbVoxels);
-  return cells_[gridCoords.x][gridCoords.y][gridCoords.z];
+Grid::VoxelCells Grid::getCellsInVoxel(Coordinates<int16_t> gridCoords) const {
+  int32_t voxel = FindVoxel(Key(gridCoords));
+  // Voxels found after the last rebuild have no cells yet
+  if (voxel < 0 or static_cast<size_t>(voxel) + 1 >= cell_start_.size())
+    return VoxelCells{nullptr, nullptr};
+  return VoxelCells{cell_index_.data() + cell_start_[voxel],
+                    cell_index_.data() + cell_start_[voxel + 1]};
 }
 
-Coordinates<int16_t> Grid::GridCoords(Coordinates<double> realCoords) const {
-  return Coordinates<int16_t>{
-      static_cast<int16_t>(floor(realCoords.x / kVoxelSize)),
-      static_cast<int16_t>(floor(realCoords.y / kVoxelSize)),
-      static_cast<int16_t>(floor(realCoords.z / kVoxelSize))};
+void Grid::set_voxel_size(double voxel_size) {
+  voxel_size_ = voxel_size;
+  ClearVoxels();
 }
 
-bool Grid::IsValid(Coordinates<int16_t> coordinates) {
-  return (coordinates.x >= 0) && (coordinates.x < kNbVoxels) &&
-      (coordinates.y >= 0) && (coordinates.y < kNbVoxels) &&
-      (coordinates.z >= 0) && (coordinates.z < kNbVoxels);
+Coordinates<int16_t> Grid::GridCoords(Coordinates<double> realCoords) const {
+  return Coordinates<int16_t>{
+      static_cast<int16_t>(floor(realCoords.x / voxel_size_)),
+      static_cast<int16_t>(floor(realCoords.y / voxel_size_)),
+      static_cast<int16_t>(floor(realCoords.z / voxel_size_))};
 }
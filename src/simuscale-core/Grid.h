@@ -32,20 +32,47 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <list>
 
-#include "Cell.h"
+#include <vector>
+
+#include <zlib.h>
+
+#include "Coordinates.h"
 
 // =================================================================
 //                          Class declarations
 // =================================================================
+class CellStore;
 
 
 /**
- * \brief The spatial structure, in the form of a 3D matrix of voxels
+ * \brief The spatial structure, a sparse set of cubic voxels
+ *
+ * The grid is rebuilt in bulk from the cell store: cells are binned into
+ * voxels with a counting sort, so that the cells of each voxel are
+ * contiguous in a flat array of store indices, in store order.
+ *
+ * Only the voxels that are (or have recently been) occupied are stored. They
+ * are found through an open-addressing hash table indexed by their
+ * coordinates, so that the memory used does not depend on the size of the
+ * world.
 */
-class Grid : public Observer {
+class Grid {
  public :
+  // =================================================================
+  //                               Types
+  // =================================================================
+  /** Store indices of the cells of a voxel */
+  struct VoxelCells {
+    const uint32_t* begin() const { return begin_; }
+    const uint32_t* end() const { return end_; }
+    bool empty() const { return begin_ == end_; }
+    size_t size() const { return end_ - begin_; }
+
+    const uint32_t* begin_;
+    const uint32_t* end_;
+  };
+
   // =================================================================
   //                             Constructors
   // =================================================================
@@ -60,17 +87,17 @@ class Grid : public Observer {
   // =================================================================
   //                              Accessors
   // =================================================================
-  std::list<Cell*>& getCellsInVoxel(Coordinates<int16_t> gridCoords);
+  /** Cells in the voxel as of the last rebuild, in store order */
+  VoxelCells getCellsInVoxel(Coordinates<int16_t> gridCoords) const;
+  double voxel_size() const { return voxel_size_; }
+  void set_voxel_size(double voxel_size);
 
   // =================================================================
   //                            Public Methods
   // =================================================================
   void print(void); // for debug purposes
-  void Update(Observable& o, ObservableEvent e, void* arg);
-  void MoveCell(Cell* cell, Coordinates<double>& old_pos);
-  void RemoveCell(Cell* cell);
-  void AddCell(Cell* cell);
-  bool IsValid(Coordinates<int16_t> coordinates);
+  /** Bin all the cells of the store into voxels */
+  void Rebuild(const CellStore& store);
 
   /*
    * Get the coordinates of the voxel containing the cell
@@ -86,17 +113,43 @@ class Grid : public Observer {
   // =================================================================
   //                           Protected Methods
   // =================================================================
-
+  static uint64_t Key(Coordinates<int16_t> gridCoords) {
+    return (static_cast<uint64_t>(static_cast<uint16_t>(gridCoords.x)) << 32) |
+           (static_cast<uint64_t>(static_cast<uint16_t>(gridCoords.y)) << 16) |
+           static_cast<uint64_t>(static_cast<uint16_t>(gridCoords.z));
+  }
+  /** Index of the voxel with the given key (-1 if none) */
+  int32_t FindVoxel(uint64_t key) const;
+  /** Index of the voxel with the given key, created if needed */
+  uint32_t FindOrAddVoxel(uint64_t key);
+  /** Slot of the hash table where the key is or would be stored */
+  size_t Slot(uint64_t key) const;
+  /** Forget all the voxels */
+  void ClearVoxels();
 
   // =================================================================
   //                          Protected Attributes
   // =================================================================
   // Size of a voxel, a 3D cubic volume containing cells
-  static constexpr double kVoxelSize = 2.0;
-  static constexpr int16_t kNbVoxels = 52;
-
-  // Each voxel has a list of cells
-  std::list<Cell*> cells_[kNbVoxels][kNbVoxels][kNbVoxels];
+  double voxel_size_ = 2.0;
+
+  // Keys of the known voxels. Voxels that become empty are kept until they
+  // outnumber the cells by far, so that they need not be hashed again
+  std::vector<uint64_t> voxel_keys_;
+
+  // Hash table (linear probing, kept at most half full) from the keys of the
+  // voxels to their index
+  static constexpr uint64_t kNoKey = UINT64_MAX;
+  std::vector<uint64_t> table_keys_;
+  std::vector<uint32_t> table_voxels_;
+
+  // Cells of the v-th voxel are cell_index_[cell_start_[v]] to
+  // cell_index_[cell_start_[v+1] - 1]
+  std::vector<uint32_t> cell_start_;
+  std::vector<uint32_t> cell_index_;
+  // Voxel of each cell and insertion cursors, kept for their capacity
+  std::vector<uint32_t> cell_voxel_;
+  std::vector<uint32_t> cursor_;
 };
 
 #endif // SIMUSCALE_GRID_H__
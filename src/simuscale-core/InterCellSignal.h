@@ -70,6 +70,8 @@ CANCER_mRNA_D1,
 CANCER_mRNA_D2,
 CANCER_mRNA_P,
 S2,
+CANCER_TRUE_JUMPS,
+CANCER_PHANTOM_JUMPS,
 };
 static std::map<InterCellSignal,std::string> InterCellSignal_Names {
   { InterCellSignal::CYCLE, "CYCLE" },
@@ -105,6 +107,8 @@ static std::map<InterCellSignal,std::string> InterCellSignal_Names {
   { InterCellSignal::CANCER_mRNA_D2, "CANCER_mRNA_D2" },
   { InterCellSignal::CANCER_mRNA_P, "CANCER_mRNA_P" },
   { InterCellSignal::S2, "S2" },
+  { InterCellSignal::CANCER_TRUE_JUMPS, "CANCER_TRUE_JUMPS" },
+  { InterCellSignal::CANCER_PHANTOM_JUMPS, "CANCER_PHANTOM_JUMPS" },
 };
 static auto const& nbr_signals = InterCellSignal_Names.size();
 #endif // SIMUSCALE_INTERCELLSIGNAL_H__
@@ -64,7 +64,7 @@ double InterCellSignals::getInSignal(InterCellSignal inSignal) const {
   }
 }
 
-std::vector<real_type> InterCellSignals::gaussian_field(InterCellSignal inSignal) const {
+const std::vector<real_type>& InterCellSignals::gaussian_field(InterCellSignal inSignal) const {
   try {
     return gaussian_fields_.at(static_cast<int>(inSignal));
   }
@@ -90,15 +90,14 @@ void InterCellSignals::Add(InterCellSignal signal, double value) {
 }
 
 
-void InterCellSignals::AddGaussianField(InterCellSignal signal, std::vector<real_type>& value) {
+void InterCellSignals::AddGaussianField(InterCellSignal signal, const real_type* value, size_t n) {
   try {
       /*int IntSignal =static_cast<int>(signal);
       if (IntSignal == 6){
       std::cout << "Signal" << IntSignal << "of init value" << signals_[IntSignal] << "is added " << value << std::endl;
       std::cout << signals_[static_cast<int> (signal)] + value << std::endl;}*/
-    for ( auto v : value ) {
-      gaussian_fields_[static_cast<int>(signal)].push_back(v);
-    }
+    std::vector<real_type>& field = gaussian_fields_.at(static_cast<int>(signal));
+    field.insert(field.end(), value, value + n);
 
   }
   catch (std::out_of_range& oor) {
@@ -133,13 +132,12 @@ void InterCellSignals::Load(gzFile backup_file) {
 
 void InterCellSignals::Save(gzFile backup_file) const {
   double tmp;
-  std::vector<real_type> tmp_v;
   for ( unsigned long i = 0; i < nbr_signals; ++i) {
     tmp = getInSignal(static_cast<InterCellSignal>(i));
     gzwrite(backup_file, &tmp, sizeof(tmp));
   }
   for ( unsigned long i = 0; i < nbr_signals; ++i) {
-    tmp_v = gaussian_field(static_cast<InterCellSignal>(i));
+    const std::vector<real_type>& tmp_v = gaussian_field(static_cast<InterCellSignal>(i));
     unsigned long size = tmp_v.size();
     gzwrite(backup_file,&size,sizeof(size));
     for ( auto t : tmp_v ) {
@@ -71,7 +71,9 @@ class InterCellSignals {
   // ==========================================================================
   void Reset();
   void Add(InterCellSignal signal, double value);
-  void AddGaussianField(InterCellSignal signal, std::vector<real_type_>& value);
+  /** Append the n values of the Gaussian field of signal at the next
+   * targets. The fields keep their capacity across Reset */
+  void AddGaussianField(InterCellSignal signal, const real_type_* value, size_t n);
   void Load(gzFile backup_file);
   void Save(gzFile backup_file) const;
 
@@ -83,7 +85,7 @@ class InterCellSignals {
     return signals_;
   }
 
-  std::vector<real_type_> gaussian_field(InterCellSignal inSignal) const;
+  const std::vector<real_type_>& gaussian_field(InterCellSignal inSignal) const;
   const std::vector<std::vector<real_type_>>& gaussian_fields() const { return gaussian_fields_; };
 
  protected :
@@ -0,0 +1,99 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "MemoryPool.h"
+
+#include <new>
+
+
+// =================================================================
+//                    Definition of static attributes
+// =================================================================
+constexpr size_t MemoryPool::kGranularity;
+constexpr size_t MemoryPool::kMaxPooledSize;
+constexpr size_t MemoryPool::kNbSizeClasses;
+constexpr size_t MemoryPool::kChunkSize;
+
+
+// =================================================================
+//                        Singleton management
+// =================================================================
+/*
+ * The pool is never destroyed: cells may be created during the static
+ * initialization of other translation units and deleted by their static
+ * destructors (e.g. the Simulation singleton)
+ */
+MemoryPool& MemoryPool::instance() {
+  static MemoryPool* pool = new MemoryPool();
+  return *pool;
+}
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+void* MemoryPool::Allocate(size_t size) {
+  if (size == 0) size = 1;
+  if (size > kMaxPooledSize) return ::operator new(size);
+
+  MemoryPool& pool = instance();
+  size_t size_class = (size - 1) / kGranularity;
+  SizeClass& sc = pool.size_classes_[size_class];
+
+  std::lock_guard<std::mutex> lock(sc.mutex);
+  if (sc.free_list == nullptr) {
+    // Carve a new chunk into blocks of this size class
+    size_t block_size = (size_class + 1) * kGranularity;
+    size_t nb_blocks = kChunkSize / block_size;
+    char* chunk = static_cast<char*>(::operator new(nb_blocks * block_size));
+    for (size_t i = nb_blocks; i-- > 0;) {
+      FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * block_size);
+      block->next = sc.free_list;
+      sc.free_list = block;
+    }
+  }
+
+  FreeBlock* block = sc.free_list;
+  sc.free_list = block->next;
+  return block;
+}
+
+void MemoryPool::Deallocate(void* ptr, size_t size) {
+  if (ptr == nullptr) return;
+  if (size == 0) size = 1;
+  if (size > kMaxPooledSize) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  SizeClass& sc = instance().size_classes_[(size - 1) / kGranularity];
+  std::lock_guard<std::mutex> lock(sc.mutex);
+  FreeBlock* block = static_cast<FreeBlock*>(ptr);
+  block->next = sc.free_list;
+  sc.free_list = block;
+}
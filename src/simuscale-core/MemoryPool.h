@@ -0,0 +1,100 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_MEMORYPOOL_H__
+#define SIMUSCALE_MEMORYPOOL_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cinttypes>
+#include <cstddef>
+
+#include <mutex>
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Size-class pool allocator for cells and their per-cell state.
+
+  Requests are rounded up to a multiple of kGranularity and served from
+  chunks of same-size blocks. Freed blocks go to a per-size freelist and are
+  reused by the next allocation of the same size, which keeps memory bounded
+  by the peak population instead of fragmenting the heap. Requests larger
+  than kMaxPooledSize go to the global operator new.
+
+  Cell overloads its operator new/delete to use the pool, plugins can use
+  Allocate/Deallocate for their variable-length state.
+*/
+class MemoryPool {
+ public :
+  // =================================================================
+  //                        Singleton management
+  // =================================================================
+ private:
+  static MemoryPool& instance();
+  MemoryPool(void) = default;
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+  virtual ~MemoryPool(void) = default;
+
+ public:
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Allocate size bytes (aligned for any fundamental type) */
+  static void* Allocate(size_t size);
+  /** Give back a block obtained from Allocate with the same size */
+  static void Deallocate(void* ptr, size_t size);
+
+  static constexpr size_t kGranularity = 16;
+  static constexpr size_t kMaxPooledSize = 4096;
+
+ protected :
+  // =================================================================
+  //                          Protected Attributes
+  // =================================================================
+  static constexpr size_t kNbSizeClasses = kMaxPooledSize / kGranularity;
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct SizeClass {
+    std::mutex mutex;
+    FreeBlock* free_list = nullptr;
+  };
+
+  SizeClass size_classes_[kNbSizeClasses];
+};
+
+#endif // SIMUSCALE_MEMORYPOOL_H__
@@ -0,0 +1,397 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "OdeSolver.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+
+
+// =================================================================
+//                           Static functions
+// =================================================================
+namespace {
+
+/** Bounds of the change of the step of the adaptive methods */
+const double kSafety = 0.9;
+const double kMinFactor = 0.2;
+const double kMaxFactor = 5.0;
+/** Smallest step, relative to the time-step, before giving up */
+const double kMinStep = 1e-12;
+
+/** Buffers of the thread, reused from one block to the next */
+double* Workspace(size_t n) {
+  static thread_local std::vector<double> buffer;
+  if (buffer.size() < n) buffer.resize(n);
+  return buffer.data();
+}
+
+uint32_t* Pivots(size_t n) {
+  static thread_local std::vector<uint32_t> buffer;
+  if (buffer.size() < n) buffer.resize(n);
+  return buffer.data();
+}
+
+void CheckStep(double step, double dt, double t, OdeSolver::Method method) {
+  if (step < kMinStep * dt) {
+    printf("ERROR: the step of the ODE solver %s fell below %g at t = %f.\n",
+           OdeSolver::name(method), kMinStep * dt, t);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/** LU decomposition with partial pivoting of the m x m matrix a, in place */
+void Decompose(double* a, uint32_t* pivots, uint32_t m) {
+  for (uint32_t k = 0; k < m; k++) {
+    uint32_t r = k;
+    for (uint32_t i = k + 1; i < m; i++) {
+      if (fabs(a[i * m + k]) > fabs(a[r * m + k])) r = i;
+    }
+    pivots[k] = r;
+    if (r != k) {
+      std::swap_ranges(a + k * m, a + (k + 1) * m, a + r * m);
+    }
+    // A singular matrix gives infinite errors and the step is rejected
+    for (uint32_t i = k + 1; i < m; i++) {
+      const double l = a[i * m + k] /= a[k * m + k];
+      for (uint32_t j = k + 1; j < m; j++) {
+        a[i * m + j] -= l * a[k * m + j];
+      }
+    }
+  }
+}
+
+/** Solve a x = b in place, a decomposed by Decompose */
+void Solve(const double* a, const uint32_t* pivots, uint32_t m, double* x) {
+  for (uint32_t k = 0; k < m; k++) {
+    std::swap(x[k], x[pivots[k]]);
+  }
+  for (uint32_t i = 1; i < m; i++) {
+    for (uint32_t j = 0; j < i; j++) {
+      x[i] -= a[i * m + j] * x[j];
+    }
+  }
+  for (uint32_t i = m; i-- > 0;) {
+    for (uint32_t j = i + 1; j < m; j++) {
+      x[i] -= a[i * m + j] * x[j];
+    }
+    x[i] /= a[i * m + i];
+  }
+}
+
+} // namespace
+
+
+// =================================================================
+//                             Constructors
+// =================================================================
+OdeSolver::OdeSolver(Rhs rhs, uint32_t size, const Settings& settings) :
+    rhs_(rhs),
+    size_(size),
+    settings_(settings) {
+}
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+void OdeSolver::Integrate(double t, double dt, double* y, const double* p,
+                          const uint8_t* active, double& h) const {
+  switch (settings_.method) {
+    case Method::RK4 :
+      IntegrateRk4(t, dt, y, p);
+      break;
+    case Method::RK45 :
+      IntegrateRk45(t, dt, y, p, active, h);
+      break;
+    case Method::ROS2 :
+      IntegrateRos2(t, dt, y, p, active, h);
+      break;
+  }
+}
+
+OdeSolver::Method OdeSolver::StrToMethod(const char* str) {
+  for (Method method : {Method::RK4, Method::RK45, Method::ROS2}) {
+    if (strcmp(str, name(method)) == 0) return method;
+  }
+  throw string("unknown ODE solver ") + str + " (use RK4/RK45/ROS2)";
+}
+
+const char* OdeSolver::name(Method method) {
+  switch (method) {
+    case Method::RK4 : return "RK4";
+    case Method::RK45 : return "RK45";
+    case Method::ROS2 : return "ROS2";
+  }
+  return "";
+}
+
+
+// =================================================================
+//                           Protected Methods
+// =================================================================
+void OdeSolver::IntegrateRk4(double t, double dt, double* y,
+                             const double* p) const {
+  const size_t n = size_ * kLanes;
+  double* k1 = Workspace(5 * n);
+  double* k2 = k1 + n;
+  double* k3 = k2 + n;
+  double* k4 = k3 + n;
+  double* tmp = k4 + n;
+
+  const double h = dt / settings_.nb_steps;
+  for (uint32_t step = 0; step < settings_.nb_steps; step++) {
+    const double t0 = t + step * h;
+    rhs_(t0, y, p, k1);
+    for (size_t i = 0; i < n; i++) tmp[i] = y[i] + 0.5 * h * k1[i];
+    rhs_(t0 + 0.5 * h, tmp, p, k2);
+    for (size_t i = 0; i < n; i++) tmp[i] = y[i] + 0.5 * h * k2[i];
+    rhs_(t0 + 0.5 * h, tmp, p, k3);
+    for (size_t i = 0; i < n; i++) tmp[i] = y[i] + h * k3[i];
+    rhs_(t0 + h, tmp, p, k4);
+    for (size_t i = 0; i < n; i++) {
+      y[i] += h / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+    }
+  }
+}
+
+void OdeSolver::IntegrateRk45(double t, double dt, double* y, const double* p,
+                              const uint8_t* active, double& h) const {
+  // Dormand-Prince coefficients, the error is the difference between the
+  // solutions of order 5 and 4
+  const double c2 = 1.0 / 5, c3 = 3.0 / 10, c4 = 4.0 / 5, c5 = 8.0 / 9;
+  const double a21 = 1.0 / 5;
+  const double a31 = 3.0 / 40, a32 = 9.0 / 40;
+  const double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+  const double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187,
+               a53 = 64448.0 / 6561, a54 = -212.0 / 729;
+  const double a61 = 9017.0 / 3168, a62 = -355.0 / 33, a63 = 46732.0 / 5247,
+               a64 = 49.0 / 176, a65 = -5103.0 / 18656;
+  const double b1 = 35.0 / 384, b3 = 500.0 / 1113, b4 = 125.0 / 192,
+               b5 = -2187.0 / 6784, b6 = 11.0 / 84;
+  const double e1 = 71.0 / 57600, e3 = -71.0 / 16695, e4 = 71.0 / 1920,
+               e5 = -17253.0 / 339200, e6 = 22.0 / 525, e7 = -1.0 / 40;
+
+  const size_t n = size_ * kLanes;
+  double* k1 = Workspace(9 * n);
+  double* k2 = k1 + n;
+  double* k3 = k2 + n;
+  double* k4 = k3 + n;
+  double* k5 = k4 + n;
+  double* k6 = k5 + n;
+  double* k7 = k6 + n;
+  double* tmp = k7 + n;
+  double* y_new = tmp + n;
+
+  const double t_end = t + dt;
+  double h_next = (h > 0.0) ? h : dt;
+  rhs_(t, y, p, k1);
+  while (t < t_end) {
+    const bool last = h_next >= t_end - t;
+    const double step = last ? t_end - t : h_next;
+    CheckStep(step, dt, t, settings_.method);
+
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = y[i] + step * a21 * k1[i];
+    }
+    rhs_(t + c2 * step, tmp, p, k2);
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = y[i] + step * (a31 * k1[i] + a32 * k2[i]);
+    }
+    rhs_(t + c3 * step, tmp, p, k3);
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = y[i] + step * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+    }
+    rhs_(t + c4 * step, tmp, p, k4);
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = y[i] + step * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i] +
+                              a54 * k4[i]);
+    }
+    rhs_(t + c5 * step, tmp, p, k5);
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = y[i] + step * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i] +
+                              a64 * k4[i] + a65 * k5[i]);
+    }
+    rhs_(t + step, tmp, p, k6);
+    for (size_t i = 0; i < n; i++) {
+      y_new[i] = y[i] + step * (b1 * k1[i] + b3 * k3[i] + b4 * k4[i] +
+                                b5 * k5[i] + b6 * k6[i]);
+    }
+    rhs_(t + step, y_new, p, k7);
+    for (size_t i = 0; i < n; i++) {
+      tmp[i] = step * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i] +
+                       e6 * k6[i] + e7 * k7[i]);
+    }
+
+    const double err = Error(y, y_new, tmp, active);
+    const double factor = StepFactor(err, 5);
+    if (err <= 1.0) {
+      t = last ? t_end : t + step;
+      std::copy(y_new, y_new + n, y);
+      std::swap(k1, k7); // the last stage is the first one of the next step
+      h_next = last ? std::max(h_next, step * factor) : step * factor;
+    }
+    else {
+      h_next = step * factor;
+    }
+  }
+  h = h_next;
+}
+
+void OdeSolver::IntegrateRos2(double t, double dt, double* y, const double* p,
+                              const uint8_t* active, double& h) const {
+  const double gamma = 1.0 + 1.0 / sqrt(2.0);
+  const uint32_t m = size_;
+  const size_t n = m * kLanes;
+  const size_t nn = static_cast<size_t>(m) * m;
+  double* f0 = Workspace(6 * n + 2 * nn * kLanes + m);
+  double* f1 = f0 + n;
+  double* k1 = f1 + n;
+  double* k2 = k1 + n;
+  double* tmp = k2 + n;
+  double* y_new = tmp + n;
+  double* jacobian = y_new + n;         // one m x m matrix per lane
+  double* lu = jacobian + nn * kLanes;  // I - gamma h J, decomposed
+  double* x = lu + nn * kLanes;
+  uint32_t* pivots = Pivots(n);
+
+  const double t_end = t + dt;
+  double h_next = (h > 0.0) ? h : dt;
+  bool new_point = true;
+  while (t < t_end) {
+    if (new_point) {
+      // Jacobian by finite differences, species j of all the lanes at once
+      rhs_(t, y, p, f0);
+      std::copy(y, y + n, tmp);
+      for (uint32_t j = 0; j < m; j++) {
+        double delta[kLanes];
+        for (uint32_t c = 0; c < kLanes; c++) {
+          const double y_j = y[j * kLanes + c];
+          tmp[j * kLanes + c] = y_j + sqrt(DBL_EPSILON) * std::max(1.0, fabs(y_j));
+          delta[c] = tmp[j * kLanes + c] - y_j;
+        }
+        rhs_(t, tmp, p, f1);
+        for (uint32_t i = 0; i < m; i++) {
+          for (uint32_t c = 0; c < kLanes; c++) {
+            jacobian[c * nn + i * m + j] =
+                (f1[i * kLanes + c] - f0[i * kLanes + c]) / delta[c];
+          }
+        }
+        for (uint32_t c = 0; c < kLanes; c++) {
+          tmp[j * kLanes + c] = y[j * kLanes + c];
+        }
+      }
+      new_point = false;
+    }
+
+    const bool last = h_next >= t_end - t;
+    const double step = last ? t_end - t : h_next;
+    CheckStep(step, dt, t, settings_.method);
+
+    // (I - gamma h J) k1 = f(t, y)
+    // (I - gamma h J) k2 = f(t + h, y + h k1) - 2 k1
+    // The lanes that hold no cell are left as they are
+    std::fill(k1, k1 + n, 0.0);
+    std::fill(k2, k2 + n, 0.0);
+    for (uint32_t c = 0; c < kLanes; c++) {
+      if (not active[c]) continue;
+      double* a = lu + c * nn;
+      for (size_t ij = 0; ij < nn; ij++) {
+        a[ij] = -gamma * step * jacobian[c * nn + ij];
+      }
+      for (uint32_t i = 0; i < m; i++) a[i * m + i] += 1.0;
+      Decompose(a, pivots + c * m, m);
+      for (uint32_t i = 0; i < m; i++) x[i] = f0[i * kLanes + c];
+      Solve(a, pivots + c * m, m, x);
+      for (uint32_t i = 0; i < m; i++) k1[i * kLanes + c] = x[i];
+    }
+    for (size_t i = 0; i < n; i++) tmp[i] = y[i] + step * k1[i];
+    rhs_(t + step, tmp, p, f1);
+    for (uint32_t c = 0; c < kLanes; c++) {
+      if (not active[c]) continue;
+      for (uint32_t i = 0; i < m; i++) {
+        x[i] = f1[i * kLanes + c] - 2.0 * k1[i * kLanes + c];
+      }
+      Solve(lu + c * nn, pivots + c * m, m, x);
+      for (uint32_t i = 0; i < m; i++) k2[i * kLanes + c] = x[i];
+    }
+
+    // The error is the difference with the solution of order 1, y + h k1
+    for (size_t i = 0; i < n; i++) {
+      y_new[i] = y[i] + step * (1.5 * k1[i] + 0.5 * k2[i]);
+      tmp[i] = 0.5 * step * (k1[i] + k2[i]);
+    }
+
+    const double err = Error(y, y_new, tmp, active);
+    const double factor = StepFactor(err, 2);
+    if (err <= 1.0) {
+      t = last ? t_end : t + step;
+      std::copy(y_new, y_new + n, y);
+      new_point = true;
+      h_next = last ? std::max(h_next, step * factor) : step * factor;
+    }
+    else {
+      h_next = step * factor;
+    }
+  }
+  h = h_next;
+}
+
+double OdeSolver::Error(const double* y, const double* y_new,
+                        const double* err, const uint8_t* active) const {
+  double max_err = 0.0;
+  for (uint32_t i = 0; i < size_; i++) {
+    for (uint32_t c = 0; c < kLanes; c++) {
+      if (not active[c]) continue;
+      const size_t k = i * kLanes + c;
+      const double scale = settings_.tolerance *
+          (1.0 + std::max(fabs(y[k]), fabs(y_new[k])));
+      const double e = fabs(err[k]) / scale;
+      if (std::isnan(e)) return e; // rejects the step
+      max_err = std::max(max_err, e);
+    }
+  }
+  return max_err;
+}
+
+double OdeSolver::StepFactor(double err, int order) {
+  if (err == 0.0) return kMaxFactor;
+  const double factor = kSafety * pow(err, -1.0 / order);
+  // NaN gives the smallest factor
+  return std::min(kMaxFactor, std::max(kMinFactor, factor));
+}
@@ -0,0 +1,145 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_ODESOLVER_H__
+#define SIMUSCALE_ODESOLVER_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cinttypes>
+#include <cstddef>
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Integration of the ODE systems of blocks of kLanes cells.
+
+  The state of a block is stored species-major: species i of the cell in
+  lane c is y[i * kLanes + c], and likewise for the parameters. The
+  right-hand side computes the derivatives of the whole block at once, so
+  that its loops over the lanes are contiguous, and the stages of the
+  methods combine the whole block as a single array.
+
+  The cells of a block share their time-steps: the adaptive methods take
+  the largest step that meets the tolerance for all the active lanes. The
+  lanes that hold no cell do not take part in the control of the step and
+  their state is meaningless.
+
+  Methods:
+    - RK4: classical Runge-Kutta of order 4, nb_steps steps per call
+    - RK45: Dormand-Prince 5(4), adaptive
+    - ROS2: 2-stage Rosenbrock method of order 2 (Verwer et al. 1999),
+      L-stable and adaptive, for stiff systems. The Jacobian is computed by
+      finite differences at the beginning of each step and the explicit
+      dependence of the right-hand side on time is neglected.
+*/
+class OdeSolver {
+ public :
+  // =================================================================
+  //                               Types
+  // =================================================================
+  enum class Method { RK4, RK45, ROS2 };
+
+  /** Right-hand side of a block, dydt = f(t, y, p) for the kLanes lanes */
+  using Rhs = void (*)(double t, const double* y, const double* p,
+                       double* dydt);
+
+  struct Settings {
+    Method method = Method::RK45;
+    /** Number of steps per call (RK4) */
+    uint32_t nb_steps = 1;
+    /** Tolerance on the error of a step, relative to 1 + |y| (RK45, ROS2) */
+    double tolerance = 1e-6;
+  };
+
+  /** Number of cells in a block */
+  static constexpr uint32_t kLanes = 8;
+
+  // =================================================================
+  //                             Constructors
+  // =================================================================
+  OdeSolver(Rhs rhs, uint32_t size, const Settings& settings);
+  OdeSolver(const OdeSolver &model) = default;
+
+  // =================================================================
+  //                             Destructor
+  // =================================================================
+  virtual ~OdeSolver(void) = default;
+
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Advance the block (y, p) from t to t + dt. The lanes for which active
+   * is 0 do not control the step. h is the first step the adaptive methods
+   * try (dt if h <= 0), it is set to the step to try next */
+  void Integrate(double t, double dt, double* y, const double* p,
+                 const uint8_t* active, double& h) const;
+
+  /** Method named str (RK4, RK45 or ROS2)
+   * \throws std::string if there is none */
+  static Method StrToMethod(const char* str);
+  static const char* name(Method method);
+
+  // =================================================================
+  //                              Accessors
+  // =================================================================
+  Rhs rhs() const { return rhs_; }
+  uint32_t size() const { return size_; }
+  const Settings& settings() const { return settings_; }
+
+ protected :
+  // =================================================================
+  //                           Protected Methods
+  // =================================================================
+  void IntegrateRk4(double t, double dt, double* y, const double* p) const;
+  void IntegrateRk45(double t, double dt, double* y, const double* p,
+                     const uint8_t* active, double& h) const;
+  void IntegrateRos2(double t, double dt, double* y, const double* p,
+                     const uint8_t* active, double& h) const;
+
+  /** Largest error of the active lanes, relative to the tolerance */
+  double Error(const double* y, const double* y_new, const double* err,
+               const uint8_t* active) const;
+
+  /** Factor applied to the step after an error err, for a method of the
+   * given order */
+  static double StepFactor(double err, int order);
+
+  // =================================================================
+  //                              Attributes
+  // =================================================================
+  Rhs rhs_;
+  uint32_t size_;
+  Settings settings_;
+};
+
+#endif // SIMUSCALE_ODESOLVER_H__
@@ -0,0 +1,149 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "OdeStore.h"
+
+#include <cassert>
+
+#include <algorithm>
+
+
+// =================================================================
+//                             Constructors
+// =================================================================
+OdeStore::OdeStore(OdeSolver::Rhs rhs, uint32_t size, uint32_t nb_params,
+                   const OdeSolver::Settings& settings) :
+    solver_(rhs, size, settings),
+    nb_params_(nb_params) {
+}
+
+OdeStore::OdeStore(OdeSolver::Rhs rhs, gzFile backup_file) :
+    solver_(rhs, 0, OdeSolver::Settings()) {
+  uint32_t size;
+  int8_t method;
+  OdeSolver::Settings settings;
+  gzread(backup_file, &size, sizeof(size));
+  gzread(backup_file, &nb_params_, sizeof(nb_params_));
+  gzread(backup_file, &method, sizeof(method));
+  gzread(backup_file, &settings.nb_steps, sizeof(settings.nb_steps));
+  gzread(backup_file, &settings.tolerance, sizeof(settings.tolerance));
+  settings.method = static_cast<OdeSolver::Method>(method);
+  solver_ = OdeSolver(rhs, size, settings);
+
+  uint32_t nb_blocks;
+  gzread(backup_file, &nb_blocks, sizeof(nb_blocks));
+  y_.resize(nb_blocks * size * OdeSolver::kLanes);
+  p_.resize(nb_blocks * nb_params_ * OdeSolver::kLanes);
+  active_.resize(nb_blocks * OdeSolver::kLanes);
+  h_.resize(nb_blocks);
+  gzread(backup_file, y_.data(), y_.size() * sizeof(y_[0]));
+  gzread(backup_file, p_.data(), p_.size() * sizeof(p_[0]));
+  gzread(backup_file, active_.data(), active_.size() * sizeof(active_[0]));
+  gzread(backup_file, h_.data(), h_.size() * sizeof(h_[0]));
+  for (uint32_t lane = 0; lane < active_.size(); lane++) {
+    if (active_[lane])
+      nb_cells_++;
+    else
+      free_lanes_.push(lane);
+  }
+}
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+uint32_t OdeStore::Acquire() {
+  if (free_lanes_.empty()) {
+    // Add a block
+    const uint32_t first = static_cast<uint32_t>(active_.size());
+    y_.resize(y_.size() + size() * OdeSolver::kLanes, 0.0);
+    p_.resize(p_.size() + nb_params_ * OdeSolver::kLanes, 0.0);
+    active_.resize(active_.size() + OdeSolver::kLanes, 0);
+    h_.push_back(0.0);
+    for (uint32_t lane = first; lane < first + OdeSolver::kLanes; lane++) {
+      free_lanes_.push(lane);
+    }
+  }
+  const uint32_t lane = free_lanes_.top();
+  free_lanes_.pop();
+  active_[lane] = 1;
+  nb_cells_++;
+  return lane;
+}
+
+uint32_t OdeStore::Acquire(uint32_t model) {
+  const uint32_t lane = Acquire();
+  for (uint32_t i = 0; i < size(); i++) y(lane, i) = y(model, i);
+  for (uint32_t i = 0; i < nb_params_; i++) p(lane, i) = p(model, i);
+  return lane;
+}
+
+void OdeStore::Release(uint32_t lane) {
+  assert(active_[lane]);
+  for (uint32_t i = 0; i < size(); i++) y(lane, i) = 0.0;
+  for (uint32_t i = 0; i < nb_params_; i++) p(lane, i) = 0.0;
+  active_[lane] = 0;
+  free_lanes_.push(lane);
+  nb_cells_--;
+}
+
+void OdeStore::Integrate(double t, double dt, int32_t threads) {
+  const size_t block_size = size() * OdeSolver::kLanes;
+  const size_t block_params = nb_params_ * OdeSolver::kLanes;
+  const size_t nb_blocks = h_.size();
+  // Blocks are independent, the result does not depend on the number of
+  // threads
+  #pragma omp parallel for schedule(dynamic) if (threads > 1)
+  for (size_t b = 0; b < nb_blocks; ++b) {
+    const uint8_t* active = active_.data() + b * OdeSolver::kLanes;
+    if (std::find(active, active + OdeSolver::kLanes, 1) ==
+        active + OdeSolver::kLanes) continue;
+    solver_.Integrate(t, dt, y_.data() + b * block_size,
+                      p_.data() + b * block_params, active, h_[b]);
+  }
+}
+
+void OdeStore::Save(gzFile backup_file) const {
+  const uint32_t size = this->size();
+  const OdeSolver::Settings& settings = solver_.settings();
+  int8_t method = static_cast<int8_t>(settings.method);
+  gzwrite(backup_file, &size, sizeof(size));
+  gzwrite(backup_file, &nb_params_, sizeof(nb_params_));
+  gzwrite(backup_file, &method, sizeof(method));
+  gzwrite(backup_file, &settings.nb_steps, sizeof(settings.nb_steps));
+  gzwrite(backup_file, &settings.tolerance, sizeof(settings.tolerance));
+
+  // The blocks are saved as they are, so that a resumed simulation
+  // integrates the same blocks with the same steps
+  uint32_t nb_blocks = static_cast<uint32_t>(h_.size());
+  gzwrite(backup_file, &nb_blocks, sizeof(nb_blocks));
+  gzwrite(backup_file, y_.data(), y_.size() * sizeof(y_[0]));
+  gzwrite(backup_file, p_.data(), p_.size() * sizeof(p_[0]));
+  gzwrite(backup_file, active_.data(), active_.size() * sizeof(active_[0]));
+  gzwrite(backup_file, h_.data(), h_.size() * sizeof(h_[0]));
+}
@@ -0,0 +1,142 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_ODESTORE_H__
+#define SIMUSCALE_ODESTORE_H__
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cinttypes>
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <zlib.h>
+
+#include "OdeSolver.h"
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+/*!
+  \brief ODE state and parameters of the cells of a formalism, in contiguous
+  blocks of OdeSolver::kLanes cells (see OdeSolver for the layout).
+
+  Each cell holds a lane of the store from the time it joins the population
+  until it is deleted. Freed lanes are reused lowest first, so that the
+  blocks stay full. Blocks are integrated independently, in parallel, and
+  keep the last step of the adaptive methods from one time-step to the next.
+*/
+class OdeStore {
+ public :
+  // =================================================================
+  //                             Constructors
+  // =================================================================
+  OdeStore(OdeSolver::Rhs rhs, uint32_t size, uint32_t nb_params,
+           const OdeSolver::Settings& settings);
+  /** Load a store saved with Save */
+  OdeStore(OdeSolver::Rhs rhs, gzFile backup_file);
+  OdeStore(const OdeStore &model) = delete;
+
+  // =================================================================
+  //                             Destructor
+  // =================================================================
+  virtual ~OdeStore(void) = default;
+
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Give a lane to a cell, with its state and parameters set to 0 */
+  uint32_t Acquire();
+  /** Give a lane to a cell, with the state and parameters of lane model */
+  uint32_t Acquire(uint32_t model);
+  /** Give back a lane obtained from Acquire */
+  void Release(uint32_t lane);
+
+  /** Advance the state of all the cells from t to t + dt */
+  void Integrate(double t, double dt, int32_t threads);
+
+  /** Save the settings of the store and all its lanes, the cells save the
+   * index of their lane */
+  void Save(gzFile backup_file) const;
+
+  // =================================================================
+  //                              Accessors
+  // =================================================================
+  /** Species i of the cell in lane */
+  double& y(uint32_t lane, uint32_t i) {
+    return y_[Index(lane, i, solver_.size())];
+  }
+  double y(uint32_t lane, uint32_t i) const {
+    return y_[Index(lane, i, solver_.size())];
+  }
+  /** Parameter i of the cell in lane */
+  double& p(uint32_t lane, uint32_t i) {
+    return p_[Index(lane, i, nb_params_)];
+  }
+  double p(uint32_t lane, uint32_t i) const {
+    return p_[Index(lane, i, nb_params_)];
+  }
+
+  uint32_t size() const { return solver_.size(); }
+  uint32_t nb_params() const { return nb_params_; }
+  const OdeSolver& solver() const { return solver_; }
+  /** Number of lanes held by cells */
+  uint32_t nb_cells() const { return nb_cells_; }
+
+ protected :
+  // =================================================================
+  //                           Protected Methods
+  // =================================================================
+  static size_t Index(uint32_t lane, uint32_t i, uint32_t stride) {
+    const uint32_t block = lane / OdeSolver::kLanes;
+    const uint32_t c = lane % OdeSolver::kLanes;
+    return (static_cast<size_t>(block) * stride + i) * OdeSolver::kLanes + c;
+  }
+
+  // =================================================================
+  //                              Attributes
+  // =================================================================
+  OdeSolver solver_;
+  uint32_t nb_params_;
+
+  /** State and parameters, a block after the other */
+  std::vector<double> y_;
+  std::vector<double> p_;
+  /** Whether each lane is held by a cell */
+  std::vector<uint8_t> active_;
+  /** Step to try next in each block (adaptive methods) */
+  std::vector<double> h_;
+
+  std::priority_queue<uint32_t, std::vector<uint32_t>,
+                      std::greater<uint32_t>> free_lanes_;
+  uint32_t nb_cells_ = 0;
+};
+
+#endif // SIMUSCALE_ODESTORE_H__
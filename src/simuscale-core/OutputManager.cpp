@@ -309,7 +309,7 @@ void OutputManager::PrintTrajectory(void) {
   //   * its x, y, z coordinates
   //   * its external radius
   //   * its intrinsic output (direct output to other cells)
-  for (auto cell : Simulation::pop().cell_list()) {
+  for (auto cell : Simulation::pop().cells()) {
     fprintf(outputs_[TRAJECTORY],
             "" FL_FMT " %" PRId32 " ",
             Simulation::sim_time(),
@@ -421,7 +421,7 @@ void OutputManager::PrintSignals(void) {
     /* Each line is one timestep and columns are ordered in the following way:
      time popsize  (for each cell : signal[0] signal[1]) */
 
-  for (Cell* cell : Simulation::pop().cell_list()){
+  for (Cell* cell : Simulation::pop().cells()){
     // TODO : Loop based on MAXINTRISICSIGNALS
     fprintf(outputs_[SIGNALS], "%" PRId32 , cell->id()); 
     for ( auto signal : Simulation::using_signals() ) {
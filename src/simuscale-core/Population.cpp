@@ -60,7 +60,10 @@ using std::endl;
 //                             Destructor
 // =================================================================
 Population::~Population(void) {
-  for (Cell* cell : cell_list_) {
+  for (Cell* cell : cells_) {
+    delete cell;
+  }
+  for (Cell* cell : removed_cells_) {
     delete cell;
   }
 }
@@ -69,6 +72,15 @@ Population::~Population(void) {
 // =================================================================
 //                            Public Methods
 // =================================================================
+void Population::SetupOdes(const CellParams& cellParams) {
+  if (cellParams.ode_system_size() == 0) return;
+  for (const auto& ode : Cell::odes()) {
+    ode_stores_[ode.first].reset(
+        new OdeStore(ode.second, cellParams.ode_system_size(),
+                     cellParams.ode_nb_params(), cellParams.ode_settings()));
+  }
+}
+
 void Population::GenerateNiche(const NicheParams& niche_params) {
   // Cells will be placed on an hexagonal mesh
   // Cells on the same row will be placed on the same x-axis, i.e. will
@@ -96,10 +108,10 @@ void Population::GenerateNiche(const NicheParams& niche_params) {
     }
     for (int16_t j = 0 ; j < nb_cols ; j++) {
       try {
-        cell_list_.push_back(Cell::MakeCell(niche_params.formalism(),
-                                            Immobile::instance(),
-                                            NICHE,
-                                            pos, initial_volume, 1.0, 0.0));
+        AddCell(Cell::MakeCell(niche_params.formalism(),
+                               Immobile::instance(),
+                               NICHE,
+                               pos, initial_volume, 1.0, 0.0));
       }
       catch (const std::exception& e) {
         cout << e.what() << endl;
@@ -153,7 +165,7 @@ void Population::AddCells(const PopulationParams& popParams,
     }
 
     try {
-      cell_list_.push_back(
+      AddCell(
           Cell::MakeCell(popParams.formalism(),
                         MoveBehaviour::instance(popParams.mb_type()),
                         popParams.cell_type(),
@@ -170,41 +182,75 @@ void Population::AddCells(const PopulationParams& popParams,
 
 
 double Population::getAvgNbInteractions() const {
-  if (cell_list_.size() == 0) return -1.0; /* no cell in the population */
+  if (cells_.size() == 0) return -1.0; /* no cell in the population */
 
   double res = 0;
-  for (Cell* cell : cell_list_) {
+  for (Cell* cell : cells_) {
     res += cell->neighbours().size();
   }
 
-  return res / cell_list_.size();
+  return res / cells_.size();
 }
 
 double Population::getAvgSignal(InterCellSignal signal) const {
-  if (cell_list_.size() == 0) return -1.0; /* no cell in the population */
+  if (cells_.size() == 0) return -1.0; /* no cell in the population */
 
   double res = 0;
-  for (Cell* cell : cell_list_) {
+  for (Cell* cell : cells_) {
     res += cell->get_output(signal);
   }
-  return res / cell_list_.size();
+  return res / cells_.size();
 }
 
+/*
+ * Remove cell from the population.
+ *
+ * The cell is only deleted by the next call to Compact(), other cells may
+ * still refer to it until the end of the time-step.
+ */
 void Population::RemoveCell(Cell* cell) {
-  cell_list_.remove(cell);
+  cells_.erase(cell->population_handle_);
+  removed_cells_.push_back(cell);
+}
+
+/*
+ * Pack the remaining cells (preserving their order) and delete removed ones
+ */
+void Population::Compact() {
+  cells_.compact();
+  for (Cell* cell : removed_cells_) {
+    delete cell;
+  }
+  removed_cells_.clear();
+}
+
+void Population::IntegrateOdes(double t, double dt, int32_t threads) {
+  for (auto& store : ode_stores_) {
+    store.second->Integrate(t, dt, threads);
+  }
 }
 
 int32_t Population::Size(void) const {
-  return cell_list_.size();
+  return cells_.size();
 }
 
 void Population::Save(gzFile backup_file) const {
   Cell::SaveStatic(backup_file);
 
-  int32_t nbCells = cell_list_.size();
+  int32_t nbStores = ode_stores_.size();
+  gzwrite(backup_file, &nbStores, sizeof(nbStores));
+  for (const auto& store : ode_stores_) {
+    gzwrite(backup_file, &store.first, sizeof(store.first));
+    store.second->Save(backup_file);
+  }
+
+  int32_t nbCells = cells_.size();
   gzwrite(backup_file, &nbCells, sizeof(nbCells));
-  for(Cell* cell : cell_list_) {
+  for(Cell* cell : cells_) {
     cell->Save(backup_file);
+    if (cell->ode_store_ != nullptr) {
+      gzwrite(backup_file, &cell->ode_lane_, sizeof(cell->ode_lane_));
+    }
   }
 }
 
@@ -212,17 +258,41 @@ void Population::Load(gzFile backup_file) {
   // Load static attributes of class Cell
   Cell::LoadStatic(backup_file);
 
+  // Load the ODE stores, the cells hold their lanes already
+  int32_t nbStores;
+  gzread(backup_file, &nbStores, sizeof(nbStores));
+  for (int32_t i = 0 ; i < nbStores ; i++) {
+    CellFormalism formalism;
+    gzread(backup_file, &formalism, sizeof(formalism));
+    if (Cell::ode_rhs(formalism) == nullptr) {
+      cout << "Error while loading cells: unknown ODE system" << endl;
+      std::terminate();
+    }
+    ode_stores_[formalism].reset(
+        new OdeStore(Cell::ode_rhs(formalism), backup_file));
+  }
+
   // Load the actual cells
   int32_t nbCells;
   gzread(backup_file, &nbCells, sizeof(nbCells));
   for(int32_t i = 0 ; i < nbCells ; i++) {
+    Cell* cell;
     try {
-      cell_list_.push_back(Cell::LoadCell(backup_file));
+      cell = Cell::LoadCell(backup_file);
     }
     catch (const std::out_of_range& e) {
       cout << "Error while loading cells: unknown cell class" << endl;
       std::terminate();
     }
+    cell->population_handle_ = cells_.insert(cell);
+    auto store = ode_stores_.find(cell->formalism());
+    if (store != ode_stores_.end()) {
+      cell->ode_store_ = store->second.get();
+      gzread(backup_file, &cell->ode_lane_, sizeof(cell->ode_lane_));
+    }
+    else {
+      AttachOde(cell);
+    }
   }
 }
 
@@ -232,6 +302,32 @@ void Population::Load(gzFile backup_file) {
 /*
  * Add cells from a list of Cell objects.
  */
-void Population::AddCells(list<Cell*> newCells) {
-  cell_list_.splice(cell_list_.end(), newCells);
+void Population::AddCells(const std::vector<Cell*>& newCells) {
+  for (Cell* cell : newCells) {
+    AddCell(cell);
+  }
+}
+
+void Population::AddCell(Cell* cell) {
+  cell->population_handle_ = cells_.insert(cell);
+  if (AttachOde(cell)) {
+    cell->InitOde();
+  }
+}
+
+bool Population::AttachOde(Cell* cell) {
+  if (cell->ode_store_ != nullptr) return false;
+  auto store = ode_stores_.find(cell->formalism());
+  if (store == ode_stores_.end()) {
+    if (Cell::ode_rhs(cell->formalism()) != nullptr) {
+      printf("ERROR: cells of formalism 0x%08" PRIx32 " have an ODE system, "
+                 "set its size with ODESYSTEMSIZE.\n",
+             cell->formalism());
+      exit(EXIT_FAILURE);
+    }
+    return false;
+  }
+  cell->ode_store_ = store->second.get();
+  cell->ode_lane_ = cell->ode_store_->Acquire();
+  return true;
 }
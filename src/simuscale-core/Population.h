@@ -33,11 +33,15 @@
 #include <cstdio>
 #include <cstdlib>
 
-#include <list>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include <zlib.h>
 
 #include "Cell.h"
+#include "CellStore.h"
+#include "OdeStore.h"
 
 // =================================================================
 //                          Class declarations
@@ -70,11 +74,17 @@ class Population {
   // =================================================================
   //                            Public Methods
   // =================================================================
+  /** Create the ODE stores of the formalisms that have an ODE system, to
+   * be called before cells are added */
+  void SetupOdes(const CellParams& cellParams);
   void GenerateNiche(const NicheParams& niche_params);
   void AddCells(const PopulationParams& popParams,
                 const CellParams& cellParams);
-  void AddCells(std::list<Cell*> newCells);
+  void AddCells(const std::vector<Cell*>& newCells);
   void RemoveCell(Cell* cell);
+  void Compact();
+  /** Advance the ODE systems of all the cells from t to t + dt */
+  void IntegrateOdes(double t, double dt, int32_t threads);
 
   double getAvgNbInteractions() const;
   double getAvgSignal(InterCellSignal signal) const;
@@ -87,20 +97,32 @@ class Population {
   // =================================================================
   //                              Accessors
   // =================================================================
-  const std::list<Cell*>& cell_list() const { // TODO <david.parsons@inria.fr> WARNING : cells are not const !
-    return cell_list_;
+  const SlotMap<Cell*>& cells() const { // TODO <david.parsons@inria.fr> WARNING : cells are not const !
+    return cells_;
   }
+  /** Contiguous copy of the cells' physical state (see CellStore) */
+  const CellStore& store() const { return store_; }
 
  protected :
   // =================================================================
   //                           Protected Methods
   // =================================================================
+  void AddCell(Cell* cell);
+  /** Give the cell a lane in the ODE store of its formalism, if it has one
+   * and the cell has none yet. Whether it was given one */
+  bool AttachOde(Cell* cell);
 
 
   // =================================================================
   //                              Attributes
   // =================================================================
-  std::list<Cell*> cell_list_;
+  /** The cells, in order of creation */
+  SlotMap<Cell*> cells_;
+  /** Cells removed during the current time-step (deleted by Compact) */
+  std::vector<Cell*> removed_cells_;
+  CellStore store_;
+  /** ODE systems of the cells, by formalism (see OdeStore) */
+  std::map<CellFormalism, std::unique_ptr<OdeStore>> ode_stores_;
 };
 
 #endif // SIMUSCALE_POPULATION_H__
@@ -0,0 +1,90 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "Simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMUSCALE_X86_SIMD
+#endif
+
+
+// =================================================================
+//                           Static functions
+// =================================================================
+namespace {
+
+Simd::Isa DetectIsa() {
+  if (Simd::Supports(Simd::Isa::AVX512))
+    return Simd::Isa::AVX512;
+  if (Simd::Supports(Simd::Isa::AVX2))
+    return Simd::Isa::AVX2;
+  return Simd::Isa::SCALAR;
+}
+
+} // namespace
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+Simd::Isa Simd::isa() {
+  static const Isa isa = DetectIsa();
+  return isa;
+}
+
+bool Simd::Supports(Isa isa) {
+  switch (isa) {
+    case Isa::SCALAR :
+      return true;
+#ifdef SIMUSCALE_X86_SIMD
+    case Isa::AVX2 :
+      return __builtin_cpu_supports("avx2");
+    case Isa::AVX512 :
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default :
+      return false;
+  }
+}
+
+std::vector<Simd::Isa> Simd::supported() {
+  std::vector<Isa> isas;
+  for (Isa isa : {Isa::SCALAR, Isa::AVX2, Isa::AVX512}) {
+    if (Supports(isa)) isas.push_back(isa);
+  }
+  return isas;
+}
+
+const char* Simd::name(Isa isa) {
+  switch (isa) {
+    case Isa::SCALAR : return "scalar";
+    case Isa::AVX2 : return "avx2";
+    case Isa::AVX512 : return "avx512";
+  }
+  return "";
+}
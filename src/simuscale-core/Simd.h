@@ -0,0 +1,68 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_SIMD_H__
+#define SIMUSCALE_SIMD_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <vector>
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Instruction sets of the paths of the vectorized kernels (see
+  ContactKernel, GaussKernel).
+
+  The CPU is probed once, the kernels use the fastest path it supports
+  unless they are given one explicitly.
+*/
+class Simd {
+ public :
+  // =================================================================
+  //                               Types
+  // =================================================================
+  enum class Isa { SCALAR, AVX2, AVX512 };
+
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Fastest path supported by the CPU */
+  static Isa isa();
+  /** Whether the CPU (and the compiler) support the path */
+  static bool Supports(Isa isa);
+  /** All the paths supported, from the slowest (SCALAR) to the fastest */
+  static std::vector<Isa> supported();
+  static const char* name(Isa isa);
+};
+
+#endif // SIMUSCALE_SIMD_H__
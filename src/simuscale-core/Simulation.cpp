@@ -38,6 +38,9 @@
 #include <iomanip>
 
 #include <zlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "params/SimulationParams.h"
 #include "params/PopulationParams.h"
@@ -71,6 +74,9 @@ Simulation::Simulation() {
 
   time_ = 0.0;
   timestep_ = 0;
+  threads_ = 1;
+  requested_threads_ = 1;
+  neighbour_skin_ = 0.0;
   tree_ = new CellTree(time_);
 }
 
@@ -133,6 +139,9 @@ void Simulation::DoSetup(const SimulationParams& simParams,
   else
     Alea::seed(simParams.seed());
 
+  SetThreads(simParams.threads());
+
+  neighbour_skin_ = simParams.neighbour_skin();
 
   // Cell parameters
   Cell::set_volume_max_min_ratio(simParams.cell_params().volume_max_min_ratio());
@@ -144,6 +153,9 @@ void Simulation::DoSetup(const SimulationParams& simParams,
   WorldSize::set_worldsize(simParams.worldsize_params().size());
   WorldSize::set_worldmargin(simParams.worldsize_params().margin());
 
+  // ODE systems of the cells, if any
+  pop_->SetupOdes(simParams.cell_params());
+
   // Add cells to the population
   for (const PopulationParams& popParams : simParams.pop_params()) {
     pop_->AddCells(popParams, simParams.cell_params());
@@ -154,13 +166,31 @@ void Simulation::DoSetup(const SimulationParams& simParams,
   pop_->GenerateNiche(simParams.niche_params());
 
 
-  // Place cells on the grid
-  for (Cell* cell : pop_->cell_list()) {
-    grid_->AddCell(cell);
+  // Size the voxels of the grid after the largest radius a cell can reach,
+  // unless the size is given in the param file
+  double voxel_size = simParams.voxel_size();
+  if (voxel_size <= 0.0) {
+    double max_radius = 0.0;
+    for (Cell* cell : pop_->cells()) {
+      max_radius = std::max(max_radius, cell->external_radius());
+    }
+    voxel_size = 2.0 * max_radius *
+        cbrt(simParams.cell_params().volume_max_min_ratio());
+    // No cell to size the voxels after (e.g. an empty setup): keep the
+    // default size of the grid
+    if (voxel_size <= 0.0) voxel_size = grid_->voxel_size();
+  }
+  Coordinates<double> world_size = WorldSize::size();
+  if (std::max({world_size.x, world_size.y, world_size.z}) / voxel_size >=
+      INT16_MAX) {
+    printf("ERROR: the world is too large for voxels of size %f, "
+               "use a larger VOXEL_SIZE.\n", voxel_size);
+    exit(EXIT_FAILURE);
   }
+  grid_->set_voxel_size(voxel_size);
 
   // Add cells in the tree at root
-  for (Cell* cell : pop_->cell_list()) {
+  for (Cell* cell : pop_->cells()) {
     tree_->AddTreeNode(tree_->root(),time_,max_timestep_*dt_,cell->id(),cell->cell_type(),cell->cell_formalism()); 
   }
 
@@ -181,6 +211,10 @@ void Simulation::DoSetup(const SimulationParams& simParams,
 
   // Output Manager setup
   output_manager_.Setup(output_dir);
+
+  // Cost model of the FGT kernels, possibly measured on this machine and
+  // saved in the output directory
+  fgt_->SetupCosts(simParams.fgt_costs(), output_dir);
   output_manager_.PrintTimeStepOutputs();
 
 }
@@ -241,6 +275,8 @@ void Simulation::DoSave() {
   gzwrite(backup_file, &backup_dtimestep_, sizeof(backup_dtimestep_));
   gzwrite(backup_file, &usecontactarea_, sizeof(usecontactarea_));
   gzwrite(backup_file, &output_orientation_, sizeof(output_orientation_));
+  gzwrite(backup_file, &requested_threads_, sizeof(requested_threads_));
+  gzwrite(backup_file, &neighbour_skin_, sizeof(neighbour_skin_));
   uint16_t size = using_signals().size();
   gzwrite(backup_file,&size,sizeof(size));
   for ( auto signal : using_signals() ) {
@@ -290,6 +326,10 @@ void Simulation::DoLoad(const string& input_dir,
   gzread(backup_file, &backup_dtimestep_, sizeof(backup_dtimestep_));
   gzread(backup_file, &usecontactarea_, sizeof(usecontactarea_));
   gzread(backup_file, &output_orientation_, sizeof(output_orientation_));
+  int32_t threads;
+  gzread(backup_file, &threads, sizeof(threads));
+  SetThreads(threads);
+  gzread(backup_file, &neighbour_skin_, sizeof(neighbour_skin_));
   uint16_t size;
   gzread(backup_file,&size,sizeof(size));
   for ( uint16_t i = 0; i < size; ++i ) {
@@ -314,11 +354,6 @@ void Simulation::DoLoad(const string& input_dir,
   fgt_->Load(backup_file);
   tree_->Load(backup_file);
 
-  // Re-place all the cells in the grid
-  for(Cell* cell : pop_->cell_list()) {
-    grid_->AddCell(cell);
-  }
-
   // Close backup file
   gzclose(backup_file);
 
@@ -326,6 +361,21 @@ void Simulation::DoLoad(const string& input_dir,
   output_manager_.SetupForResume(input_dir, output_dir);
 }
 
+void Simulation::SetThreads(int32_t threads) {
+  requested_threads_ = threads;
+#ifdef _OPENMP
+  if (threads > 0) {
+    threads_ = threads;
+    omp_set_num_threads(threads_);
+  }
+  else {
+    threads_ = omp_get_max_threads();
+  }
+#else
+  threads_ = 1;
+#endif
+}
+
 void Simulation::DoDump(const string& input_dir,
                         double backup_time, int dump) {
   // Open backup file
@@ -358,6 +408,10 @@ void Simulation::DoDump(const string& input_dir,
   gzread(backup_file, &backup_dtimestep_, sizeof(backup_dtimestep_));
   gzread(backup_file, &usecontactarea_, sizeof(usecontactarea_));
   gzread(backup_file, &output_orientation_, sizeof(output_orientation_));
+  int32_t threads;
+  gzread(backup_file, &threads, sizeof(threads));
+  SetThreads(threads);
+  gzread(backup_file, &neighbour_skin_, sizeof(neighbour_skin_));
   cout << "{\n"
        << "  \"time\": " << time_ << ",\n"; 
   cout << "  \"timestep\": " << timestep_ << ",\n";
@@ -411,8 +465,8 @@ void Simulation::DoDump(const string& input_dir,
   }
   cout << "  ],\n";
   cout << "  \"cells\": [\n";
-  auto n = pop_->cell_list().size();
-  for (Cell* cell : pop_->cell_list()) {
+  auto n = pop_->cells().size();
+  for (Cell* cell : pop_->cells()) {
     cell->Dump();
     if ( --n ) cout << ",";
     cout << "\n";
@@ -442,40 +496,84 @@ void Simulation::DoDump(const string& input_dir,
  * Compute the cell-neighbourhood of each cell
  */
 void Simulation::ComputeNeighbourhood() {
+  CellStore& store = pop_->store_;
+
+  // Cells can only come in contact with their candidates as long as these are
+  // valid, without a skin they have to be searched for at each time-step
+  if (not store.CandidatesValid()) {
+    BuildNeighbourCandidates();
+  }
+
+  // Each cell only writes its own neighbour lists: cells can be processed
+  // concurrently with no effect on the result
+  const uint32_t nb_cells = store.size();
+  #pragma omp parallel for schedule(static) if (threads_ > 1)
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    store.SelectNeighbours(i);
 
-  // For each cell, compute neighbourhood
-  for (Cell* cell : pop_->cell_list_) {
+    Cell* cell = store.cell(i);
     cell->ResetNeighbours();
+    for (uint32_t j : store.neighbours(i)) {
+      cell->AddNeighbour(store.cell(j));
+    }
+  }
+}
+
+/**
+ * Find, for each cell, the cells that are closer to it than the sum of their
+ * external radii plus the skin
+ */
+void Simulation::BuildNeighbourCandidates() {
+  // Each cell only writes its own candidate list while the grid is read-only:
+  // cells can be processed concurrently with no effect on the result
+  CellStore& store = pop_->store_;
+  const std::vector<double>& ext_radius = store.external_radius();
+  const uint32_t nb_cells = store.size();
+  if (nb_cells == 0) return;
+
+  // Bin the cells into voxels at their current positions
+  grid_->Rebuild(store);
+
+  // Number of voxels to look at in each direction
+  double max_radius = *std::max_element(ext_radius.begin(), ext_radius.end());
+  const int16_t reach = static_cast<int16_t>(
+      ceil((2.0 * max_radius + neighbour_skin_) / grid_->voxel_size()));
+  #pragma omp parallel for schedule(static) if (threads_ > 1)
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    store.ResetCandidates(i);
 
     // Determine which voxel the cell is in
-    auto cellCoords = grid_->GridCoords(cell->pos());
+    auto cellCoords = grid_->GridCoords(store.pos(i));
 
     // For each cell within the neighbouring voxels, add it to the current
-    // cell's neighbor list if they are in contact with each other
-    for (int16_t dX = -1; dX <= 1; dX++)
-        for (int16_t dY = -1; dY <= 1; dY++)
-        for (int16_t dZ = -1; dZ <= 1; dZ++) {
+    // cell's candidates if they are close enough to each other
+    for (int16_t dX = -reach; dX <= reach; dX++)
+        for (int16_t dY = -reach; dY <= reach; dY++)
+        for (int16_t dZ = -reach; dZ <= reach; dZ++) {
       // Replace all this by grid_->getClosebyCells ou getNeigbouringCells
       Coordinates<int16_t> curCoords{static_cast<int16_t>(cellCoords.x + dX),
                                      static_cast<int16_t>(cellCoords.y + dY),
                                      static_cast<int16_t>(cellCoords.z + dZ)};
 
-      // If voxel is valid...
-      if (grid_->IsValid(curCoords)) {
-        // For each cell in voxel
-        for (Cell* neighbCell : grid_->getCellsInVoxel(curCoords)) {
-          // Skip over the current cell itself
-          if (neighbCell->id() == cell->id()) continue;
-
-          // If cells are in contact, add neighbCell to neighbours
-          if (cell->Distance(neighbCell) <
-              neighbCell->external_radius() + cell->external_radius()) {
-            cell->AddNeighbour(neighbCell);
-          }
+      // For each cell in voxel
+      for (uint32_t j : grid_->getCellsInVoxel(curCoords)) {
+        // Skip over the current cell itself
+        if (j == i) continue;
+
+        if (store.Distance(i, j) <
+            ext_radius[j] + ext_radius[i] + neighbour_skin_) {
+          store.AddCandidate(i, j);
         }
       }
     }
+
+    // Neighbours are listed in store order whatever the voxel they are in,
+    // so that the forces they exert are summed in the same order with or
+    // without a skin
+    store.SortCandidates(i);
   }
+
+  store.CandidatesBuilt(neighbour_skin_);
 }
 
 /**
@@ -487,13 +585,13 @@ void Simulation::ComputeNeighbourhood() {
 void Simulation::CheckNeighbourhood() {
   cout << "Checking neighborhood at time " << time_ << endl;
   // Locate neighbors
-  for (Cell* cell : pop_->cell_list())
+  for (Cell* cell : pop_->cells())
   {
     std::vector<Cell*> neighbours;
 
     // For each cell add it the the current cell's neighbor list if they are
     // in contact with each other
-    for (Cell* neighbCell : pop_->cell_list())
+    for (Cell* neighbCell : pop_->cells())
     {
       // Skip over the current cell itself
       if (neighbCell->id() == cell->id()) continue;
@@ -527,27 +625,60 @@ void Simulation::CheckNeighbourhood() {
  * Compute mechanical and biochemical interactions between cells
  */
 void Simulation::ComputeInteractions() {
+  // Gather the physical state of the cells for this time-step
+  CellStore& store = pop_->store_;
+  store.Gather(pop_->cells_);
+
   // Compute the cell-neighbourhood of each cell
   ComputeNeighbourhood();
 
-  // For each cell compute the cumulative action of all its neighbours on it,
-  // both mechanically and chemically
-  for (Cell* cell : pop_->cell_list()) {
-    cell->ComputeInteractions();
+  // Compute the interactions once for each pair of neighbours, by blocks
+  // that are large enough for the vectorized force kernel
+  store.BuildPairs();
+  static constexpr uint32_t kPairBlock = 256;
+  const uint32_t nb_pairs = store.nb_pairs();
+  #pragma omp parallel for schedule(static) if (threads_ > 1)
+  for (uint32_t begin = 0; begin < nb_pairs; begin += kPairBlock) {
+    store.ComputePairs(begin, std::min(begin + kPairBlock, nb_pairs));
+  }
+
+  // For each cell sum the action of all its neighbours on it, both
+  // mechanically and chemically.
+  // A cell only writes its own forces and inputs, reading its neighbours'
+  // outputs, which are left untouched during this phase
+  const uint32_t nb_cells = store.size();
+  #pragma omp parallel for schedule(static) if (threads_ > 1)
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    store.GatherSignals(i);
+  }
+  #pragma omp parallel for schedule(static) if (threads_ > 1)
+  for (uint32_t i = 0; i < nb_cells; ++i) {
+    store.ComputeMechForce(i);
+    store.ScatterMechForce(i);
+    store.ComputeChemInputs(i);
   }
 }
 
 void Simulation::ComputeGaussianFields() {
   // Direct computation of Gaussian fields
-  //for (Cell* cell : pop_->cell_list()) {
+  //for (Cell* cell : pop_->cells()) {
   //  cell->ComputeGaussianFields();
   //}
 
-  for ( auto signal : fgt_->using_diffusive_signals() ) {
-    fgt_->init_transform(signal);
+  // Signals with the same delta, epsilon and solver share the sources,
+  // targets and boxes of the transform
+  for ( auto& signals : fgt_->signal_groups() ) {
+    fgt_->init_transform(signals);
     double nb_boxes = pow(sqrt(2.0/fgt_->delta()) + 1,3);
-    // cout << " signal: " << static_cast<int>(signal) << " scaled delta: " << fgt_->delta() << " nb boxes: " << nb_boxes << " ";
-    if ( pop_->cell_list().size() < nb_boxes ) {
+    // cout << " signals: " << signals.size() << " scaled delta: " << fgt_->delta() << " nb boxes: " << nb_boxes << " ";
+    if ( fgt_->solver() == DiffusionSolver::ADAPTIVE ) {
+      fgt_->adaptive_transform();
+    }
+    else if ( fgt_->solver() == DiffusionSolver::MESH ) {
+      fgt_->mesh_transform();
+    }
+    else if ( fgt_->tuned() ? fgt_->direct_is_cheaper()
+                            : pop_->cells().size() < nb_boxes ) {
       // cout << "direct ";
       fgt_->direct_transform();
     }
@@ -569,41 +700,64 @@ void Simulation::ComputeGaussianFields() {
  * and take a step in time
  */
 void Simulation::ApplyUpdate() {
-  list<Cell*> newCells;
-  auto cell_it = std::begin(pop_->cell_list());
-
-  // for (Cell* cell : pop_->cell_list()) {
-  /** 
-   *  sb:
-   *  it is not possible to use range-based for loops
-   *  when the elements of the list are removed. 
-   *  When an element of the list is removed (with std::list::remove)
-   *  the iterator becomes invalidated, and this results in 
-   *  undefined behavior. 
-   *  Solution: use a while loop and increment the iterator before
-   *  the element of the list is being removed.
-   */ 
-  while ( cell_it != std::end(pop_->cell_list()) ) {
-    Cell* cell = *cell_it; // get the cell 
-    ++cell_it;             // safe to increment--cell_it is not used anywhere else in the loop
-    cell->Update(dt_);
+  // Compute pass: every cell computes its next state from the current state of
+  // the population. Nothing that other cells can observe (position, size, type)
+  // is modified here and each cell draws from its own random stream, so cells
+  // can be processed concurrently with no effect on the result
+  const std::vector<Cell*>& cells = pop_->store_.cells();
+  const size_t nb_cells = cells.size();
+
+  // The internal state of the cells whose formalism has a batch update is
+  // updated afterwards, all the cells of the formalism at once
+  for (auto& batch : batches_) batch.second.clear();
+  batched_.assign(nb_cells, false);
+  for (size_t i = 0; i < nb_cells; ++i) {
+    CellFormalism formalism = cells[i]->formalism();
+    if (Cell::batch_update(formalism) != nullptr) {
+      batches_[formalism].push_back(cells[i]);
+      batched_[i] = true;
+    }
+  }
+
+  #pragma omp parallel for schedule(dynamic) if (threads_ > 1)
+  for (size_t i = 0; i < nb_cells; ++i) {
+    Alea::ScopedStream stream(cells[i]->id(), timestep_, kUpdateStream);
+    if (batched_[i])
+      cells[i]->ComputeMove(dt_);
+    else
+      cells[i]->ComputeUpdate(dt_);
+  }
+  for (auto& batch : batches_) {
+    if (batch.second.empty()) continue;
+    Cell::batch_update(batch.first)(batch.second.data(), batch.second.size(),
+                                    dt_);
+  }
+
+  // The ODE systems of the cells are integrated over the time-step with the
+  // parameters set by the internal updates
+  pop_->IntegrateOdes(time_, dt_, threads_);
+
+  // Commit pass: apply the new states then deaths and divisions in canonical
+  // (id) order
+  std::vector<Cell*> newCells;
+  for (Cell* cell : cells) {
+    cell->CommitUpdate();
 
     UpdateMinMaxSignals(cell);
 
-    // If cell marked as "to die", remove it from the grid and from the pop,
+    // If cell marked as "to die", remove it from the pop,
     // then step to the next cell
     if (cell->isDead()) {
       tree_->GetNodeFromId(cell->id())->set_time_of_tip(time_);
-      grid_->RemoveCell(cell);
       pop_->RemoveCell(cell);
       continue;
     }
 
     // If cell marked as "to divide", make it do so
     if (cell->isDividing()) {
+      Alea::ScopedStream stream(cell->id(), timestep_, kDivisionStream);
       Cell* newCell = cell->Divide();
       newCells.push_back(newCell);
-      grid_->AddCell(newCell);
       tree_->AddTreeNode(tree_->GetNodeFromId(cell->id()),time_,max_timestep_*dt_,newCell->id(),newCell->cell_type(),newCell->cell_formalism());
     }
   }
@@ -612,6 +766,7 @@ void Simulation::ApplyUpdate() {
   if (newCells.size() > 0) {
     pop_->AddCells(newCells);
   }
+  pop_->Compact();
 
   time_ += dt_;
   timestep_ ++;
@@ -33,6 +33,7 @@
 #include <cstdio>
 #include <cstdlib>
 
+#include <array>
 #include <string>
 
 #include "params/SimulationParams.h"
@@ -64,7 +65,7 @@ class Simulation
 
   using real_type_ = float;
   using uint_type_ = uint32_t;
-  using point_type_ = array<real_type_, 3>;
+  using point_type_ = std::array<real_type_, 3>;
 
   // =================================================================
   //                        Singleton management
@@ -110,6 +111,15 @@ class Simulation
   static bool output_orientation() { return instance_.output_orientation_; };
   static const CellTree& tree() { return *(instance_.tree_); }; 
   static const FastGaussTransform3D* fgt() { return instance_.fgt_; }
+  static int32_t threads() { return instance_.threads_; }
+
+  /** Phases of a time-step in which cells draw random numbers, each cell
+   * has a distinct random stream for each of them (see Alea::ScopedStream) */
+  static constexpr uint32_t kUpdateStream = 0;
+  static constexpr uint32_t kDivisionStream = 1;
+  /** Internal updates of the cells updated by batch (see
+   * Cell::CellBatchUpdate) */
+  static constexpr uint32_t kInternalStream = 2;
 
 
 
@@ -122,11 +132,14 @@ class Simulation
   void Finalize();
   void Update();
   void ComputeNeighbourhood();
+  void BuildNeighbourCandidates();
   void CheckNeighbourhood();
   void ComputeInteractions();
   void ComputeGaussianFields();
   void ApplyUpdate();
   void UpdateMinMaxSignals(Cell* cell);
+  /** Use the given number of threads (0 means as many as available) */
+  void SetThreads(int32_t threads);
 
   void DoSave();
   void DoLoad(const string& input_dir,
@@ -149,10 +162,21 @@ class Simulation
   double dt_;
   /** Number of timesteps between 2 backups */
   int32_t backup_dtimestep_;
+  /** Number of threads used by the parallel phases */
+  int32_t threads_;
+  /** Number of threads asked for (THREADS, 0 for AUTO), kept in the backups */
+  int32_t requested_threads_;
+  /** Margin added to the contact distance for the neighbour candidate lists */
+  double neighbour_skin_;
 
   /** The cell population */
   Population* pop_;
 
+  /** Cells of each formalism with a batch update, for the current step */
+  std::map<CellFormalism, std::vector<Cell*>> batches_;
+  /** Whether each cell of the population is in batches_ */
+  std::vector<char> batched_;
+
   /** Fast Gaussian Transform */
   FastGaussTransform3D* fgt_;
 
@@ -0,0 +1,177 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_SLOTMAP_H__
+#define SIMUSCALE_SLOTMAP_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cinttypes>
+#include <cassert>
+#include <cstddef>
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Generational slot map: O(1) insertion and erasure through stable
+  handles, iteration over a dense array in insertion order.
+
+  Erasing an element only leaves a tombstone in the dense array, which is
+  skipped by iterators. Compact() removes tombstones while preserving the
+  order of the remaining elements. A handle becomes invalid as soon as its
+  element is erased, even if its slot is reused afterwards.
+*/
+template<typename T>
+class SlotMap {
+ public :
+  /** Stable reference to an element */
+  struct Handle {
+    uint32_t index = kInvalid;
+    uint32_t generation = 0;
+  };
+
+  class const_iterator;
+
+  // =================================================================
+  //                             Constructors
+  // =================================================================
+  SlotMap(void) = default;
+  SlotMap(const SlotMap&) = delete;
+  SlotMap& operator=(const SlotMap&) = delete;
+
+  // =================================================================
+  //                             Destructor
+  // =================================================================
+  virtual ~SlotMap(void) = default;
+
+  // =================================================================
+  //                              Accessors
+  // =================================================================
+  /** Number of elements (tombstones excluded) */
+  size_t size() const { return values_.size() - nb_tombstones_; }
+  bool empty() const { return size() == 0; }
+  bool contains(Handle handle) const;
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, values_.size()); }
+
+  // =================================================================
+  //                              Operators
+  // =================================================================
+  T& operator[](Handle handle);
+  const T& operator[](Handle handle) const;
+
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Append value at the end of the dense order */
+  Handle insert(const T& value);
+  /** Erase the element referred to by handle (leaves a tombstone) */
+  void erase(Handle handle);
+  /** Remove tombstones, preserving the order of the elements */
+  void compact();
+  void reserve(size_t capacity);
+  void clear();
+
+  /**
+   * Forward iterator over the elements, skipping tombstones
+   */
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator(const SlotMap* map, size_t dense_index) :
+        map_(map), dense_index_(dense_index) { skip_tombstones(); }
+
+    reference operator*() const { return map_->values_[dense_index_]; }
+    pointer operator->() const { return &map_->values_[dense_index_]; }
+    const_iterator& operator++() {
+      ++dense_index_;
+      skip_tombstones();
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+    bool operator==(const const_iterator& rhs) const {
+      return dense_index_ == rhs.dense_index_;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return dense_index_ != rhs.dense_index_;
+    }
+
+   private:
+    void skip_tombstones() {
+      while (dense_index_ < map_->values_.size() &&
+             map_->dense_slots_[dense_index_] == kInvalid)
+        ++dense_index_;
+    }
+
+    const SlotMap* map_;
+    size_t dense_index_;
+  };
+
+ protected :
+  // =================================================================
+  //                              Attributes
+  // =================================================================
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+
+  struct Slot {
+    uint32_t dense_index;
+    uint32_t generation;
+  };
+
+  /** Values in insertion order, possibly with tombstones */
+  std::vector<T> values_;
+  /** Slot of each dense entry, kInvalid for tombstones */
+  std::vector<uint32_t> dense_slots_;
+  /** Indirection from handles to dense entries */
+  std::vector<Slot> slots_;
+  /** Slots available for reuse */
+  std::vector<uint32_t> free_slots_;
+  size_t nb_tombstones_ = 0;
+};
+
+#include "SlotMap.hpp"
+
+#endif // SIMUSCALE_SLOTMAP_H__
@@ -0,0 +1,135 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "SlotMap.h"
+
+
+// =================================================================
+//                    Definition of static attributes
+// =================================================================
+template<typename T>
+constexpr uint32_t SlotMap<T>::kInvalid;
+
+
+// =================================================================
+//                             Accessors
+// =================================================================
+template<typename T>
+bool SlotMap<T>::contains(Handle handle) const {
+  return handle.index < slots_.size() &&
+         slots_[handle.index].generation == handle.generation &&
+         slots_[handle.index].dense_index != kInvalid;
+}
+
+
+// =================================================================
+//                             Operators
+// =================================================================
+template<typename T>
+T& SlotMap<T>::operator[](Handle handle) {
+  assert(contains(handle));
+  return values_[slots_[handle.index].dense_index];
+}
+
+template<typename T>
+const T& SlotMap<T>::operator[](Handle handle) const {
+  assert(contains(handle));
+  return values_[slots_[handle.index].dense_index];
+}
+
+
+// =================================================================
+//                           Public Methods
+// =================================================================
+template<typename T>
+typename SlotMap<T>::Handle SlotMap<T>::insert(const T& value) {
+  uint32_t slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(Slot{kInvalid, 0});
+  }
+  else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  slots_[slot].dense_index = static_cast<uint32_t>(values_.size());
+  values_.push_back(value);
+  dense_slots_.push_back(slot);
+
+  Handle handle;
+  handle.index = slot;
+  handle.generation = slots_[slot].generation;
+  return handle;
+}
+
+template<typename T>
+void SlotMap<T>::erase(Handle handle) {
+  assert(contains(handle));
+  Slot& slot = slots_[handle.index];
+  dense_slots_[slot.dense_index] = kInvalid;
+  slot.dense_index = kInvalid;
+  slot.generation++;
+  free_slots_.push_back(handle.index);
+  nb_tombstones_++;
+}
+
+template<typename T>
+void SlotMap<T>::compact() {
+  if (nb_tombstones_ == 0) return;
+
+  size_t next = 0;
+  for (size_t i = 0; i < values_.size(); i++) {
+    if (dense_slots_[i] == kInvalid) continue;
+    if (i != next) {
+      values_[next] = std::move(values_[i]);
+      dense_slots_[next] = dense_slots_[i];
+      slots_[dense_slots_[next]].dense_index = static_cast<uint32_t>(next);
+    }
+    next++;
+  }
+  values_.resize(next);
+  dense_slots_.resize(next);
+  nb_tombstones_ = 0;
+}
+
+template<typename T>
+void SlotMap<T>::reserve(size_t capacity) {
+  values_.reserve(capacity);
+  dense_slots_.reserve(capacity);
+  slots_.reserve(capacity);
+}
+
+template<typename T>
+void SlotMap<T>::clear() {
+  values_.clear();
+  dense_slots_.clear();
+  slots_.clear();
+  free_slots_.clear();
+  nb_tombstones_ = 0;
+}
@@ -0,0 +1,41 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+/* DiffusionSolver.h */
+
+#ifndef SIMUSCALE_DIFFUSIONSOLVER_H__
+#define SIMUSCALE_DIFFUSIONSOLVER_H__
+
+#include <stdint.h>
+
+/** Algorithm used to compute the field of a diffusive signal */
+enum class DiffusionSolver : uint8_t {
+  UNIFORM,    /* fast Gauss transform on a uniform grid of boxes
+                 (direct sum when there are fewer cells than boxes) */
+  ADAPTIVE,   /* fast Gauss transform on an octree of the occupied space */
+  MESH        /* sources spread on a regular mesh, FFT convolution */
+};
+
+#endif // SIMUSCALE_DIFFUSIONSOLVER_H__
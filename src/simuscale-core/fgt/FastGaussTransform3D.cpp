@@ -26,6 +26,11 @@
 
 #include "FastGaussTransform3D.h"
 
+#include <cstdio>
+#include <chrono>
+#include <functional>
+#include <random>
+
 using namespace std;
 
 using real_type = FastGaussTransform3D::real_type_;
@@ -34,6 +39,9 @@ using point_type = FastGaussTransform3D::point_type_;
 
 /* static member factorial_ needs to be declared */
 constexpr unsigned long long FastGaussTransform3D::factorial_[20];
+constexpr uint_type FastGaussTransform3D::max_p_;
+constexpr uint_type FastGaussTransform3D::max_window_;
+constexpr const char* FastGaussTransform3D::costs_file_name_;
 
 /**
  * 
@@ -47,7 +55,11 @@ FastGaussTransform3D::FastGaussTransform3D( vector<real_type> q,
                                                                  t_(t), 
                                                                  delta_(delta), 
                                                                  epsilon_(epsilon)
-{ }
+{
+  /* q holds the weights of the sources for each signal, one after another */
+  nb_signals_ = s_.empty() ? 1 : q_.size()/s_.size();
+  scale_transform();
+}
 
 void FastGaussTransform3D::Setup(const SimulationParams& simParams) {
 
@@ -55,49 +67,264 @@ void FastGaussTransform3D::Setup(const SimulationParams& simParams) {
   using_diffusive_signals_ = simParams.using_diffusive_signals();
   diffusive_delta_ = simParams.diffusive_delta();
   diffusive_epsilon_ = simParams.diffusive_epsilon();
+  diffusive_solver_ = simParams.diffusive_solver();
+  group_signals();
+
+}
+
+/** SetupCosts: cost model of the kernels, _costs_ is DEFAULT, CALIBRATE
+ *  (the kernels are timed and the model is written in _output_dir_ for
+ *  reuse) or the file of a previous calibration
+ */
+void FastGaussTransform3D::SetupCosts(const string& costs, const string& output_dir) {
+
+  if ( costs == "DEFAULT" || using_diffusive_signals_.empty() ) return;
+
+  if ( costs == "CALIBRATE" ) {
+    calibrate();
+    write_costs(output_dir + "/" + costs_file_name_);
+    printf("FGT cost model: %g ns per multiply-add, %g ns per exponential\n",
+           madd_cost_, exp_cost_);
+  }
+  else {
+    read_costs(costs);
+  }
 
+}
+
+/** calibrate: time the four kernels between a box of random sources and a
+ *  box of random targets, and fit the cost model to the times (least
+ *  squares of the relative errors)
+ */
+void FastGaussTransform3D::calibrate() {
+
+  const uint_type n = 256;
+  minstd_rand gen(1);
+  uniform_real_distribution<real_type> uniform(0.0f, 1.0f);
+  vector<real_type> q(n);
+  vector<point_type> s(n), t(n);
+  for ( uint_type i = 0; i < n; i++ ) {
+    q[i] = uniform(gen);
+    s[i] = {uniform(gen), uniform(gen), uniform(gen)};
+    t[i] = {uniform(gen), uniform(gen), uniform(gen)};
+  }
+
+  /* all the points in one box, with a typical expansion order */
+  FastGaussTransform3D bench(q, s, t, 1.0f, 1e-4);
+  bench.p_ = 8;
+  const uint_type p = bench.p_;
+  const double p3 = p*p*p;
+  bench.source_order_.resize(n);
+  bench.target_order_.resize(n);
+  for ( uint_type i = 0; i < n; i++ ) bench.source_order_[i] = bench.target_order_[i] = i;
+  bench.sort_points();
+  bench.select_signal(0);
+  bench.A_.assign(p3, 0.0);
+  bench.B_.assign(p3, 0.0);
+  const Box source = {0, n, {0.5f, 0.5f, 0.5f}};
+  const Box target = {0, n, {0.5f, 0.5f, 0.5f}};
+  bench.hermite_coeffs(source, bench.A_.data());
+
+  /* time of a call in ns, repeated for at least 20 ms */
+  auto time = [](const function<void()>& kernel) {
+    uint32_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    chrono::duration<double, nano> elapsed(0);
+    do {
+      kernel();
+      calls++;
+      elapsed = chrono::steady_clock::now() - start;
+    } while ( elapsed.count() < 2e7 );
+    return elapsed.count()/calls;
+  };
+
+  /* numbers of multiply-adds and of exponentials of each kernel, as in
+   * plan_leaf, and their times */
+  const double madds[4] = {0.0, n*p3, n*p3, d_*p3*p};
+  const double exps[4] = {(double) n*n, (double) d_*n, (double) d_*n, d_*(2.0*p - 1)};
+  double times[4];
+  times[DIRECT_DIRECT] = time([&]() { bench.direct_direct(source, target); });
+  times[DIRECT_TAYLOR] = time([&]() { bench.direct_taylor(source, target, bench.B_.data()); });
+  times[HERMITE_DIRECT] = time([&]() { bench.hermite_direct(source, bench.A_.data(), target); });
+  times[HERMITE_TAYLOR] = time([&]() { bench.hermite_taylor(source, bench.A_.data(), target, bench.B_.data()); });
+
+  /* minimize sum ((madd*madds + exp*exps)/times - 1)^2 */
+  double uu = 0.0, uv = 0.0, vv = 0.0, u1 = 0.0, v1 = 0.0;
+  for ( uint_type k = 0; k < 4; k++ ) {
+    double u = madds[k]/times[k];
+    double v = exps[k]/times[k];
+    uu += u*u;
+    uv += u*v;
+    vv += v*v;
+    u1 += u;
+    v1 += v;
+  }
+  double det = uu*vv - uv*uv;
+  madd_cost_ = (u1*vv - v1*uv)/det;
+  exp_cost_ = (uu*v1 - uv*u1)/det;
+  if ( ! (madd_cost_ > 0.0 && exp_cost_ > 0.0) ) {
+    /* degenerate fit: the kernels dominated by each operation */
+    madd_cost_ = times[HERMITE_TAYLOR]/madds[HERMITE_TAYLOR];
+    exp_cost_ = times[DIRECT_DIRECT]/exps[DIRECT_DIRECT];
+  }
+  tuned_ = true;
+
+}
+
+/** write_costs: save the cost model in _file_ */
+void FastGaussTransform3D::write_costs(const string& file) const {
+
+  FILE* costs_file = fopen(file.c_str(), "w");
+  if ( costs_file == NULL ) {
+    printf("ERROR: could not write the FGT cost model to \"%s\".\n", file.c_str());
+    exit(EXIT_FAILURE);
+  }
+  fprintf(costs_file, "# cost model of the fast Gauss transform kernels, in ns\n");
+  fprintf(costs_file, "MADD %.17g\n", madd_cost_);
+  fprintf(costs_file, "EXP %.17g\n", exp_cost_);
+  fclose(costs_file);
 
 }
 
-void FastGaussTransform3D::init_transform(InterCellSignal signal) {
+/** read_costs: load the cost model written by write_costs in _file_ */
+void FastGaussTransform3D::read_costs(const string& file) {
+
+  FILE* costs_file = fopen(file.c_str(), "r");
+  if ( costs_file == NULL ) {
+    printf("ERROR: could not read the FGT cost model \"%s\".\n", file.c_str());
+    exit(EXIT_FAILURE);
+  }
+  char line[256];
+  bool madd = false, exp = false;
+  while ( fgets(line, sizeof(line), costs_file) != NULL ) {
+    if ( sscanf(line, "MADD %lf", &madd_cost_) == 1 ) madd = true;
+    if ( sscanf(line, "EXP %lf", &exp_cost_) == 1 ) exp = true;
+  }
+  fclose(costs_file);
+  if ( ! (madd && exp && madd_cost_ > 0.0 && exp_cost_ > 0.0) ) {
+    printf("ERROR: \"%s\" must give positive MADD and EXP costs.\n", file.c_str());
+    exit(EXIT_FAILURE);
+  }
+  tuned_ = true;
+
+}
+
+/** group_signals: group the diffusive signals that have the same delta,
+ *  epsilon and solver, in the order of their declaration. The signals of a
+ *  group are transformed together
+ */
+void FastGaussTransform3D::group_signals() {
+
+  signal_groups_.clear();
+  vector<uint_type> group_ind;  /* index of the first signal of each group */
+  uint_type sig_ind = 0;
+  for ( auto signal : using_diffusive_signals_ ) {
+    uint_type g = 0;
+    while ( g < group_ind.size() &&
+            !( diffusive_delta_[group_ind[g]] == diffusive_delta_[sig_ind] &&
+               diffusive_epsilon_[group_ind[g]] == diffusive_epsilon_[sig_ind] &&
+               diffusive_solver_[group_ind[g]] == diffusive_solver_[sig_ind] ) ) {
+      g++;
+    }
+    if ( g == group_ind.size() ) {
+      group_ind.push_back(sig_ind);
+      signal_groups_.push_back(vector<InterCellSignal>());
+    }
+    signal_groups_[g].push_back(signal);
+    sig_ind++;
+  }
+
+}
+
+/** init_transform: collect the sources and the targets of _signals_, which
+ *  share delta, epsilon and solver. The cells are visited once: a source
+ *  point is shared by the signals a cell emits from the same position, and
+ *  the targets by the signals with the same targets, so that the geometry
+ *  of the transform is built once for all the signals. The weights of the
+ *  signals that a source point does not emit are 0.
+ */
+void FastGaussTransform3D::init_transform(const vector<InterCellSignal>& signals) {
 
   point_type p;
-  cell_list_ = &Simulation::pop().cell_list();
-  signal_ = signal;
+  cell_list_ = &Simulation::pop().cells();
+  signals_ = signals;
+  nb_signals_ = signals_.size();
 
   unsigned int sig_ind = 0;
   for ( auto sig : using_diffusive_signals_ ) {
-    if ( sig == signal_ ) {
+    if ( sig == signals_.front() ) {
       break;
     }
     sig_ind++;
   }
   delta_ = diffusive_delta_[sig_ind];
   epsilon_ = diffusive_epsilon_[sig_ind];
+  solver_ = diffusive_solver_[sig_ind];
 
+  /* the workspaces keep their capacity from one step to the next */
+  source_weights_.clear();
+  signal_targets_.resize(nb_signals_);
+  cell_targets_.clear();
   for (Cell* cell : *cell_list_) {
-    real_type q = cell->gaussian_field_weight(signal_);
-    if ( q != 0.0f ) {
-      q_.push_back(cell->gaussian_field_weight(signal_));
-      p[0] = cell->gaussian_field_source(signal_).x;
-      p[1] = cell->gaussian_field_source(signal_).y;
-      p[2] = cell->gaussian_field_source(signal_).z;
-      s_.push_back(p);
+    size_t first_source = s_.size();
+    for ( uint_type k = 0; k < nb_signals_; k++ ) {
+      real_type q = cell->gaussian_field_weight(signals_[k]);
+      if ( q != 0.0f ) {
+        p[0] = cell->gaussian_field_source(signals_[k]).x;
+        p[1] = cell->gaussian_field_source(signals_[k]).y;
+        p[2] = cell->gaussian_field_source(signals_[k]).z;
+        size_t j = first_source;
+        while ( j < s_.size() && s_[j] != p ) j++;
+        if ( j == s_.size() ) {
+          s_.push_back(p);
+          source_weights_.insert(source_weights_.end(), nb_signals_, 0.0f);
+        }
+        source_weights_[j*nb_signals_ + k] = q;
+      }
     }
-    for ( auto pc : cell->gaussian_field_targets(signal_) ) {
-      p[0] = pc.x;
-      p[1] = pc.y;
-      p[2] = pc.z;
-      t_.push_back(p);
+    for ( uint_type k = 0; k < nb_signals_; k++ ) {
+      vector<Coordinates<double>>& targets = signal_targets_[k];
+      cell->gaussian_field_targets(signals_[k], targets);
+      uint_type l = 0;
+      while ( l < k && signal_targets_[l] != targets ) l++;
+      if ( l < k ) {
+        cell_targets_.push_back(cell_targets_[cell_targets_.size() - k + l]);
+        continue;
+      }
+      cell_targets_.push_back({(uint_type) t_.size(), (uint_type) targets.size()});
+      for ( auto& pc : targets ) {
+        p[0] = pc.x;
+        p[1] = pc.y;
+        p[2] = pc.z;
+        t_.push_back(p);
+      }
     }
 
   }
 
+  /* weights signal after signal */
+  const size_t N = s_.size();
+  q_.resize(nb_signals_*N);
+  for ( size_t j = 0; j < N; j++ ) {
+    for ( uint_type k = 0; k < nb_signals_; k++ ) {
+      q_[k*N + j] = source_weights_[j*nb_signals_ + k];
+    }
+  }
+
+  scale_transform();
+
+}
+
+/** scale_transform: rescale sources and targets in the unit cube
+ *  and set the size of the boxes accordingly
+ */
+void FastGaussTransform3D::scale_transform() {
+
   N_ = s_.size();
   M_ = t_.size();
 
-  G_.assign(M_,0.0);
-  Gexact_.assign(M_,0.0);
+  G_.assign(M_*nb_signals_,0.0);
+  Gexact_.assign(M_*nb_signals_,0.0);
 
   // printf( "  N = %u  M = %u, delta = %g\n", N_, M_, delta_);
 
@@ -110,6 +337,13 @@ void FastGaussTransform3D::init_transform(InterCellSignal signal) {
 
   evals_ = {0,0,0,0};
 
+#ifdef _OPENMP
+  const size_t nb_workspaces = omp_get_max_threads();
+#else
+  const size_t nb_workspaces = 1;
+#endif
+  if ( workspaces_.size() < nb_workspaces ) workspaces_.resize(nb_workspaces);
+
 }
 
 void FastGaussTransform3D::renormalize() {
@@ -163,12 +397,10 @@ void FastGaussTransform3D::renormalize() {
 
 }
 
-void FastGaussTransform3D::fast_transform() {
-
-  /* array of list of source and target points in each box */
-  Bs_.assign(N_side_*N_side_*N_side_,Box3(0,{0,0,0}));
-  Bt_.assign(N_side_*N_side_*N_side_,Box3(0,{0,0,0}));  
-
+/** expansion_order: choose the order p_ of the expansions, the range n_
+ *  of the interactions and the thresholds N_F_, M_L_ from epsilon_
+ */
+void FastGaussTransform3D::expansion_order() {
 
   /* check for maximal value of epsilon */
   if ( epsilon_ > 0.1 ) 
@@ -194,11 +426,11 @@ void FastGaussTransform3D::fast_transform() {
   while ( - 0.5*lgamma(p_ + 1) + log(1 - ipow(1 - ipow(r_,p_),d_)) - d_*log(1-r_) > log(epsilon_) )  
   {
     p_++;
-    if ( p_ > 11 )
+    if ( p_ > max_p_ )
     {
       fprintf(stderr,"  Error: Hermite expansion order too large.\n");
-      fprintf(stderr,"  Setting p_ = 11. Error may be above tolerance epsilon = %g\n", epsilon_);
-      p_ = 11;
+      fprintf(stderr,"  Setting p_ = %u. Error may be above tolerance epsilon = %g\n", max_p_, epsilon_);
+      p_ = max_p_;
       break;
     }
   }
@@ -208,143 +440,649 @@ void FastGaussTransform3D::fast_transform() {
 
   /* N_F, M_L_: bounds on numbers of sources/targets to use 
    * Hermite or Taylor expansions
-   * Greengard proposes O(p_^(d-1)), but 
-   * TODO: get a more optimal threshold
+   * Greengard proposes O(p_^(d-1)). With a tuned cost model, they are the
+   * crossovers of the direct sum (an exponential per pair) and of a series
+   * (p^d terms and d tables of exponentials per target, resp. source)
    */
-  N_F_ = (int)ipow(p_,d_-1);
-  M_L_ = (int)ipow(p_,d_-1);
+  if ( tuned_ ) {
+    double crossover = (ipow(p_,d_) + d_*exp_ratio())/exp_ratio();
+    N_F_ = (uint_type) ceil(crossover);
+    M_L_ = (uint_type) crossover;
+  }
+  else {
+    N_F_ = (int)ipow(p_,d_-1);
+    M_L_ = (int)ipow(p_,d_-1);
+  }
   // printf("  N_F = M_L_ = %d\n\n",N_F_);
 
-  /* list all non empty boxes, non empty source boxes and non empty target boxes */ 
-  for ( auto point : s_ ) {
-    non_empty_source_list_.insert(p2b(point));
-    non_empty_box_list_.insert(p2b(point));
+}
+
+void FastGaussTransform3D::fast_transform() {
+
+  expansion_order();
+
+  /* Sort source and target points by box, list the non empty source boxes
+   * and the non empty target boxes.
+   * Empty boxes are never used, so they require no storage.
+   */
+  sort_by_box(s_, N_side_, source_start_, source_order_, source_boxes_);
+  sort_by_box(t_, N_side_, target_start_, target_order_, target_boxes_);
+  sort_points();
+
+  /* Hermite coefficients for each source box, 
+   * Taylor coefficients for each target box */
+  const uint_type p3 = p_*p_*p_;
+  A_.resize(source_boxes_.size()*p3);
+  B_.resize(target_boxes_.size()*p3);
+
+  /* The boxes are the same for all the signals, only the weights change */
+  evals_ = {0,0,0,0};
+  for ( uint_type k = 0; k < nb_signals_; k++ )
+  {
+    if ( !emits(k) ) continue;  /* its field is 0 */
+    select_signal(k);
+    fast_evaluate();
+    scatter_field(k);
   }
-  for ( auto point : t_ ) {
-    non_empty_target_list_.insert(p2b(point));
-    non_empty_box_list_.insert(p2b(point));
+
+} /* endof fast_gaussian_transform_3d */
+
+/** fast_evaluate: field of the selected signal at the sorted targets, on
+ *  the boxes of the uniform transform
+ */
+void FastGaussTransform3D::fast_evaluate() {
+
+  const uint_type p3 = p_*p_*p_;
+  fill(B_.begin(), B_.end(), 0.0);
+
+  const int32_t threads = Simulation::threads();
+
+  /* A_alpha: Hermite coefficient of far field (source) expansion,
+   * for each source box that sends out a Hermite expansion */
+  #pragma omp parallel for schedule(dynamic) if (threads > 1)
+  for ( size_t b = 0; b < source_boxes_.size(); b++ )
+  {
+    Box source = source_box(source_boxes_[b]);
+    if ( source.n() >= N_F_ )
+      hermite_coeffs(source, &A_[b*p3]);
   }
 
-  /* Initialize boxes 
-   * range over all non_empty boxes only. 
-   * unitilized boxes are never used, so they require no action.
+  /* Main loop */
+  /* The field at the targets of a box only depends on the source boxes in
+   * range: target boxes are processed concurrently, each one gathering the
+   * contributions of its source boxes in increasing index order. This gives
+   * the same result whatever the number of threads.
    */
-  for ( auto i : non_empty_source_list_ )   {
-    Bs_.at(i).set_center({ (i % N_side_ + 0.5f)/N_side_,
-                          ( (i / N_side_) % N_side_ + 0.5f)/N_side_,
-                          (i / (N_side_*N_side_) + 0.5f)/N_side_});
-    Bs_.at(i).set_index(i);
-    Bs_.at(i).B().assign(p_*p_*p_,0);
+  uint32_t evals0 = 0, evals1 = 0, evals2 = 0, evals3 = 0;
+  #pragma omp parallel if (threads > 1) \
+                       reduction(+:evals0, evals1, evals2, evals3)
+  {
+    vector<uint_type>& ilist = workspace().list;
+    array<uint32_t, 4> evals = {0, 0, 0, 0};
+    #pragma omp for schedule(dynamic)
+    for ( size_t b = 0; b < target_boxes_.size(); b++ )
+    {
+      gather_target_box(b, ilist, evals);
+    }
+    evals0 += evals[0];
+    evals1 += evals[1];
+    evals2 += evals[2];
+    evals3 += evals[3];
   }
-  for ( auto i : non_empty_target_list_ )   {
-    Bt_.at(i).set_center({ (i % N_side_ + 0.5f)/N_side_,
-                          ( (i / N_side_) % N_side_ + 0.5f)/N_side_,
-                          (i / (N_side_*N_side_) + 0.5f)/N_side_});
-    Bt_.at(i).set_index(i);
+  evals_[0] += evals0;
+  evals_[1] += evals1;
+  evals_[2] += evals2;
+  evals_[3] += evals3;
+
+}
 
-    /* Taylor coefficient for each target box that requires it */
-    Bt_.at(i).B().assign(p_*p_*p_,0); 
+/** adaptive_transform: fast Gauss transform on an octree of the occupied
+ *  space. Cubes are only subdivided if they contain enough points, down to
+ *  the size of the boxes of the uniform transform, so that the expansions
+ *  have the same order and error bound. Source leaves closer than the
+ *  cutoff distance of the Gaussians interact with each target leaf, the
+ *  kind of interaction is chosen from the actual numbers of points.
+ */
+void FastGaussTransform3D::adaptive_transform() {
+
+  expansion_order();
+
+  /* the root is the smallest cube containing the unit cube whose side is
+   * the size of the boxes times a power of 2, so that the smallest leaves
+   * are the boxes of the uniform transform. The points are sorted leaf by
+   * leaf */
+  real_type half = 0.5f/N_side_;
+  while ( 2*half < 1.0f ) half *= 2;
+  source_order_.resize(N_);
+  for ( uint_type i = 0; i < N_; i++ ) source_order_[i] = i;
+  target_order_.resize(M_);
+  for ( uint_type i = 0; i < M_; i++ ) target_order_[i] = i;
+  nodes_.clear();
+  leaves_.clear();
+  nodes_.push_back({{half, half, half}, half, 0, N_, 0, M_, 0, 0});
+  build_octree(0, source_order_, buffer_);
+  sort_points();
+
+  const uint_type p3 = p_*p_*p_;
+  const size_t nb_leaves = leaves_.size();
+  A_.resize(nb_leaves*p3);
+  B_.resize(nb_leaves*p3);
+  interactions_.resize(nb_leaves);
+  taylor_.assign(nb_leaves, 0);
+
+  const int32_t threads = Simulation::threads();
+
+  /* interaction lists */
+  #pragma omp parallel if (threads > 1)
+  {
+    vector<uint_type>& stack = workspace().list;
+    #pragma omp for schedule(dynamic)
+    for ( size_t k = 0; k < nb_leaves; k++ )
+    {
+      plan_leaf(k, stack);
+    }
   }
 
-  /* Distribute source and target points in each box */
-  for ( uint_type i = 0; i < N_; i++ ) {
-    Bs_.at(p2b(s_.at(i))).p().push_back(i);
+  /* source leaves that send out an expansion */
+  hermite_.assign(nb_leaves, 0);
+  for ( size_t k = 0; k < nb_leaves; k++ )
+  {
+    for ( auto& interaction : interactions_[k] )
+    {
+      if ( interaction.second == HERMITE_DIRECT || interaction.second == HERMITE_TAYLOR )
+        hermite_[interaction.first] = 1;
+    }
   }
-  for ( uint_type i = 0; i < M_; i++) {
-    Bt_.at(p2b(t_.at(i))).p().push_back(i);
+
+  /* The octree and the interaction lists are the same for all the signals,
+   * only the weights change */
+  evals_ = {0,0,0,0};
+  for ( uint_type k = 0; k < nb_signals_; k++ )
+  {
+    if ( !emits(k) ) continue;  /* its field is 0 */
+    select_signal(k);
+    adaptive_evaluate();
+    scatter_field(k);
   }
-  
-  /* A_alpha: Hermite coefficient of far field (source) expansion */
-  A_alpha_.assign(p_*p_*p_, 0.0);
 
-  /* Main loop */
-  /* range over all non-empty source boxes */
-  for ( auto i : non_empty_source_list_ )   
+}
+
+/** adaptive_evaluate: field of the selected signal at the sorted targets,
+ *  on the leaves of the octree
+ */
+void FastGaussTransform3D::adaptive_evaluate() {
+
+  const uint_type p3 = p_*p_*p_;
+  const size_t nb_leaves = leaves_.size();
+  fill(B_.begin(), B_.end(), 0.0);
+
+  const int32_t threads = Simulation::threads();
+
+  /* Hermite coefficients of the source leaves that send out an expansion */
+  #pragma omp parallel for schedule(dynamic) if (threads > 1)
+  for ( size_t k = 0; k < nb_leaves; k++ )
   {
-      size_t N_B = Bs_.at(i).n(); /* nbr sources in Box i */
+    if ( hermite_[k] ) hermite_coeffs(source_leaf(k), &A_[k*p3]);
+  }
 
-      form_interaction_list(i); 
-      if ( N_B < N_F_ )                          /* Source Box sends out N_B Gaussians */
-      {
-        for ( auto k : ilist_ )  /* range over target boxes in range */
-        {
-          size_t Mc = Bt_.at(k).n();         /* nbr of targets in k-th box */
-          if ( Mc == 0 ) continue;
-          if ( Mc <= M_L_ )                      /* few targets. C evaluates all fields immediately */
-          {
-            direct_direct(Bs_.at(i),Bt_.at(k));
-          }
-          else                                  /* Mc > M_L_: many targets. C transforms all fields to Taylor series */
-          {
-            /* Bt[ilist.l[k]].B points to the Taylor coefficients
-             * of target Box with index ilist.l[k] 
-             * direct_taylor accumulates the Taylor coefficients for box ilist.l[k]
-             */
-            direct_taylor(Bs_.at(i), Bt_.at(k));
-            taylor_box_list_.insert(k);
-          }
+  /* Main loop, over the target leaves */
+  uint32_t evals0 = 0, evals1 = 0, evals2 = 0, evals3 = 0;
+  #pragma omp parallel if (threads > 1) \
+                       reduction(+:evals0, evals1, evals2, evals3)
+  {
+    array<uint32_t, 4> evals = {0, 0, 0, 0};
+    #pragma omp for schedule(dynamic)
+    for ( size_t k = 0; k < nb_leaves; k++ )
+    {
+      gather_target_leaf(k, evals);
+    }
+    evals0 += evals[0];
+    evals1 += evals[1];
+    evals2 += evals[2];
+    evals3 += evals[3];
+  }
+  evals_[0] += evals0;
+  evals_[1] += evals1;
+  evals_[2] += evals2;
+  evals_[3] += evals3;
 
-        }
+}
+
+/** mesh_transform: particle-mesh Gauss transform. Since Gaussians convolve
+ *  into Gaussians, exp(-|t-s|^2/delta_) is computed as the Gaussian of
+ *  delta_/4 from the source to the nodes of a regular mesh (spreading), of
+ *  delta_/2 between nodes (convolution, by FFT one axis at a time since the
+ *  Gaussian is separable) and of delta_/4 from the nodes to the target
+ *  (interpolation), divided by the Riemann-sum constant. The mesh spacing is
+ *  chosen so that the aliasing error of these sums is well below epsilon_,
+ *  and the Gaussians are truncated well below epsilon_. The mesh spacing is
+ *  proportional to sqrt(delta_): the cost decreases as the Gaussian widens.
+ */
+void FastGaussTransform3D::mesh_transform() {
+
+  /* check for maximal value of epsilon */
+  if ( epsilon_ > 0.1 ) 
+  { 
+    fprintf(stderr,"  Warning: epsilon = %g is too large, using epsilon = 0.1 instead\n",epsilon_);
+    epsilon_ = 0.1;
+  }
+
+  const double delta_s = delta_/4;    /* spreading and interpolation */
+  /* the aliasing and truncation errors of the three axes and of the two
+   * sums add up, coherently when the Gaussian is wider than the domain */
+  const double tol = epsilon_/10;
+  const double delta_m = delta_/2;    /* mesh */
+  /* the sums over nodes of Gaussians of delta_/6 (the narrowest product)
+   * alias as 2 exp(-pi^2 delta_/(6 h^2)) */
+  const double h = M_PI*sqrt(delta_/(6*log(2/tol)));
+  /* spreading window: w nodes on each side, mesh: n nodes per dimension
+   * with w nodes beyond the unit cube on each side */
+  const uint_type w = (uint_type) ceil(sqrt(delta_s*log(1/tol))/h);
+  const uint_type n = (uint_type) ceil(1/h) + 2*w + 1;
+  const double norm = pow(M_PI*delta_s*sqrt(delta_m/delta_)/(h*h), 3);
+
+  /* spectrum of the mesh Gaussian, truncated where it is below epsilon
+   * and padded for a linear convolution */
+  const uint_type K = min(n - 1, (uint_type) ceil(sqrt(-delta_m*log(tol))/h));
+  const uint_type L = Fft::Size(n + K);
+  if ( fft_.size() != L ) fft_ = Fft(L);
+  vector<complex<double>>& kernel = workspaces_[0].line;
+  kernel.assign(L, 0.0);
+  for ( uint_type k = 0; k <= K; k++ ) {
+    double g = exp(-(k*h)*(k*h)/delta_m);
+    kernel[k] = g;
+    if ( k > 0 ) kernel[L - k] = g;
+  }
+  fft_.Forward(kernel.data());
+  spectrum_.resize(L);
+  for ( uint_type k = 0; k < L; k++ ) spectrum_[k] = kernel[k].real();
+
+  /* weights of the 2w nodes around x along each axis, node a being at
+   * (a - w) h, and index of the first one */
+  real_type weights[3][2*max_window_];
+  size_t first[3];
+  auto window = [&](const point_type& x) {
+    for ( uint_type d = 0; d < d_; d++ ) {
+      double u = x[d]/h + w;
+      uint_type a0 = (uint_type) u - w + 1;
+      first[d] = a0;
+      for ( uint_type a = 0; a < 2*w; a++ ) {
+        double r = (u - a0 - a)*h;
+        weights[d][a] = exp(-r*r/delta_s);
       }
-      else                                      /* B sends out a Hermite expansion */
-      {
-        /* compute A_alpha: the _p^3 Hermite expansion coefficients */
-        hermite_coeffs(Bs_.at(i));   
-        for ( auto k : ilist_ )  /* range over target boxes in range */
-        {
-          size_t Mc = Bt_.at(k).n();         /* nbr of targets in k-th box */
-          if ( Mc == 0 ) continue;
-          if ( Mc <= M_L_ )                      /* few targets. C evaluates all fields immediately */
-          {
-            /* direct evaluation of the _p-th order Hermite expansion */ 
-            hermite_direct(Bs_.at(i).center(), Bt_.at(k));
+    }
+  };
+  if ( w > max_window_ ) {
+    fprintf(stderr,"  Error: mesh spreading window too large for epsilon = %g\n", epsilon_);
+    exit(1);
+  }
+
+  /* the mesh and its spectrum are the same for all the signals */
+  for ( uint_type k = 0; k < nb_signals_; k++ ) {
+    if ( !emits(k) ) continue;  /* its field is 0 */
+    const real_type* q = &q_[(size_t) k*N_];
+    real_type* G = &G_[(size_t) k*M_];
+
+    /* spread the sources */
+    mesh_.assign((size_t) n*n*n, 0.0);
+    for ( uint_type j = 0; j < N_; j++ ) {
+      window(s_[j]);
+      for ( uint_type c = 0; c < 2*w; c++ ) {
+        for ( uint_type b = 0; b < 2*w; b++ ) {
+          real_type qw = q[j]*weights[2][c]*weights[1][b];
+          real_type* row = &mesh_[first[0] + n*(first[1] + b) + (size_t) n*n*(first[2] + c)];
+          for ( uint_type a = 0; a < 2*w; a++ ) {
+            row[a] += qw*weights[0][a];
           }
-          else                                  /* Mc > M_L_: many targets. C transforms all fields to Taylor series */
-          {
-            /* accumulate Taylor coefficient from Hermite expansion */  
-            hermite_taylor(Bt_.at(k), Bs_.at(i).center());
-            taylor_box_list_.insert(k);
+        }
+      }
+    }
+
+    for ( uint_type axis = 0; axis < d_; axis++ ) {
+      convolve_axis(n, axis, spectrum_);
+    }
+
+    /* interpolate at the targets */
+    for ( uint_type i = 0; i < M_; i++ ) {
+      window(t_[i]);
+      double g = 0.0;
+      for ( uint_type c = 0; c < 2*w; c++ ) {
+        for ( uint_type b = 0; b < 2*w; b++ ) {
+          const real_type* row = &mesh_[first[0] + n*(first[1] + b) + (size_t) n*n*(first[2] + c)];
+          double gb = 0.0;
+          for ( uint_type a = 0; a < 2*w; a++ ) {
+            gb += row[a]*weights[0][a];
           }
+          g += gb*weights[1][b]*weights[2][c];
         }
       }
+      G[i] = g/norm;
+    }
   }
 
-  /* evaluate Taylor expansion at target points */ 
-  /* range over all non empty target boxes */
-  for ( auto i : taylor_box_list_ )   
+}
+
+/** convolve_axis: convolve each line of the mesh along _axis_ with the
+ *  kernel of spectrum _spectrum_. Lines are transformed two at a time, as
+ *  the real and imaginary parts of a complex line (the kernel is real and
+ *  even, so is its spectrum). Empty lines are skipped.
+ */
+void FastGaussTransform3D::convolve_axis(uint_type n, uint_type axis,
+                                         const vector<double>& spectrum) {
+
+  const uint_type L = fft_.size();
+  const size_t stride = axis == 0 ? 1 : axis == 1 ? n : (size_t) n*n;
+  const uint_type nb_lines = n*n;
+  auto first = [&](uint_type l) -> size_t {  /* first node of line l */
+    if ( axis == 0 ) return (size_t) l*n;
+    if ( axis == 1 ) return l % n + (size_t) (l / n)*n*n;
+    return l;
+  };
+
+  #pragma omp parallel if (Simulation::threads() > 1)
   {
-    size_t Mc = Bt_.at(i).n(); /* nbr of targets in i-th target box */
-    if ( Mc > M_L_ )
+    vector<complex<double>>& line = workspace().line;
+    line.resize(L);
+    #pragma omp for schedule(static)
+    for ( uint_type pair = 0; pair < (nb_lines + 1)/2; pair++ )
     {
-      for ( auto k : Bt_.at(i).p() )   /* range over all targets in box i */
-      {
-        for ( uint_type beta1 = 0; beta1 < p_; beta1++)  
-        {
-          for ( uint_type beta2 = 0; beta2 < p_; beta2++)
-          {
-            for ( uint_type beta3 = 0; beta3 < p_; beta3++)
-            {
-              G_.at(k) += Bt_.at(i).B().at(beta1*p_*p_ + beta2*p_ + beta3)* \
-                               ipow((t_.at(k).at(0) - Bt_.at(i).center().at(0))/sqrt(delta_),beta1)* \
-                               ipow((t_.at(k).at(1) - Bt_.at(i).center().at(1))/sqrt(delta_),beta2)* \
-                               ipow((t_.at(k).at(2) - Bt_.at(i).center().at(2))/sqrt(delta_),beta3);
-            }
-          }
-        }
+      size_t b0 = first(2*pair);
+      bool two = 2*pair + 1 < nb_lines;
+      size_t b1 = two ? first(2*pair + 1) : b0;
+
+      bool empty = true;
+      for ( uint_type i = 0; i < n; i++ ) {
+        line[i] = complex<double>(mesh_[b0 + i*stride], two ? mesh_[b1 + i*stride] : 0.0);
+        if ( line[i] != 0.0 ) empty = false;
+      }
+      if ( empty ) continue;
+      fill(line.begin() + n, line.end(), 0.0);
+
+      fft_.Forward(line.data());
+      for ( uint_type k = 0; k < L; k++ ) line[k] *= spectrum[k];
+      fft_.Inverse(line.data());
+
+      for ( uint_type i = 0; i < n; i++ ) {
+        mesh_[b0 + i*stride] = line[i].real();
+        if ( two ) mesh_[b1 + i*stride] = line[i].imag();
       }
     }
   }
 
-} /* endof fast_gaussian_transform_3d */
+}
+
+/** sort_points: copy the sources in the order source_order_, and the
+ *  targets in the order target_order_, into the sorted arrays
+ */
+void FastGaussTransform3D::sort_points() {
+
+  sx_.resize(N_);
+  sy_.resize(N_);
+  sz_.resize(N_);
+  for ( uint_type i = 0; i < N_; i++ ) {
+    sx_[i] = s_[source_order_[i]][0];
+    sy_[i] = s_[source_order_[i]][1];
+    sz_[i] = s_[source_order_[i]][2];
+  }
+  tx_.resize(M_);
+  ty_.resize(M_);
+  tz_.resize(M_);
+  for ( uint_type i = 0; i < M_; i++ ) {
+    tx_[i] = t_[target_order_[i]][0];
+    ty_[i] = t_[target_order_[i]][1];
+    tz_[i] = t_[target_order_[i]][2];
+  }
+
+}
+
+/** emits: whether a source has a non-zero weight for the k-th signal */
+bool FastGaussTransform3D::emits(uint_type k) const {
+
+  const real_type* q = &q_[(size_t) k*N_];
+  return any_of(q, q + N_, [](real_type qj) { return qj != 0.0f; });
+
+}
+
+/** select_signal: copy the weights of the k-th signal in the sorted array
+ *  and reset the field at the sorted targets
+ */
+void FastGaussTransform3D::select_signal(uint_type k) {
+
+  const real_type* q = &q_[(size_t) k*N_];
+  sq_.resize(N_);
+  for ( uint_type i = 0; i < N_; i++ ) {
+    sq_[i] = q[source_order_[i]];
+  }
+  Gs_.assign(M_, 0.0);
+
+}
+
+/** scatter_field: copy the field at the sorted targets in the field of the
+ *  k-th signal in G
+ */
+void FastGaussTransform3D::scatter_field(uint_type k) {
+
+  real_type* G = &G_[(size_t) k*M_];
+  for ( uint_type i = 0; i < M_; i++ ) {
+    G[target_order_[i]] = Gs_[i];
+  }
+
+}
+
+/** build_octree: subdivide the cube of node _index_ in octants, and
+ *  recursively its occupied octants, until they are as small as the boxes
+ *  of the uniform transform or contain too few points for expansions to
+ *  pay off. The sources and targets of the octants are kept contiguous in
+ *  _source_order_ and target_order_; the leaves are listed in leaves_.
+ */
+void FastGaussTransform3D::build_octree(uint_type index,
+                                        vector<uint_type>& source_order,
+                                        vector<uint_type>& buffer) {
+
+  const Node node = nodes_[index];  /* nodes_ grows below */
+
+  if ( 2*node.half <= 1.0f/N_side_*1.0001f ||
+       (node.s_end - node.s_begin <= N_F_ && node.t_end - node.t_begin <= M_L_) )
+  {
+    nodes_[index].children = leaves_.size();
+    leaves_.push_back(index);
+    return;
+  }
+
+  array<uint_type, 9> s_split = split_octants(s_, node.center, node.s_begin, node.s_end,
+                                              source_order, buffer);
+  array<uint_type, 9> t_split = split_octants(t_, node.center, node.t_begin, node.t_end,
+                                              target_order_, buffer);
+
+  uint_type children = nodes_.size();
+  real_type half = 0.5f*node.half;
+  for ( uint_type o = 0; o < 8; o++ )
+  {
+    if ( s_split[o + 1] == s_split[o] && t_split[o + 1] == t_split[o] ) continue;
+    point_type center = {node.center[0] + (o & 1 ? half : -half),
+                         node.center[1] + (o & 2 ? half : -half),
+                         node.center[2] + (o & 4 ? half : -half)};
+    nodes_.push_back({center, half, s_split[o], s_split[o + 1],
+                      t_split[o], t_split[o + 1], 0, 0});
+  }
+  nodes_[index].children = children;
+  nodes_[index].nb_children = nodes_.size() - children;
+
+  for ( uint_type c = children; c < children + nodes_[index].nb_children; c++ )
+  {
+    build_octree(c, source_order, buffer);
+  }
+
+}
+
+/** split_octants: stable counting sort of the points _order_[begin] to
+ *  _order_[end - 1] by octant around _center_ (bit 0: x, 1: y, 2: z).
+ *  The points of octant o are then at positions start[o] to start[o + 1] - 1.
+ */
+array<uint_type, 9> FastGaussTransform3D::split_octants(const vector<point_type>& points,
+                                                        const point_type& center,
+                                                        uint_type begin, uint_type end,
+                                                        vector<uint_type>& order,
+                                                        vector<uint_type>& buffer) const {
+
+  /* octant of each point, then the points sorted by octant */
+  const uint_type n = end - begin;
+  array<uint_type, 9> start;
+  start.fill(0);
+  buffer.resize(2*n);
+  for ( uint_type i = begin; i < end; i++ ) {
+    const point_type& p = points[order[i]];
+    uint_type o = (p[0] >= center[0]) + 2*(p[1] >= center[1]) + 4*(p[2] >= center[2]);
+    buffer[i - begin] = o;
+    start[o + 1]++;
+  }
+  start[0] = begin;
+  for ( uint_type o = 0; o < 8; o++ ) start[o + 1] += start[o];
+
+  array<uint_type, 8> cursor;
+  copy(start.begin(), start.begin() + 8, cursor.begin());
+  for ( uint_type i = begin; i < end; i++ ) {
+    buffer[n + cursor[buffer[i - begin]]++ - begin] = order[i];
+  }
+  copy(buffer.begin() + n, buffer.end(), order.begin() + begin);
+
+  return start;
+}
+
+/** plan_leaf: list, in depth-first order, the source leaves closer to the
+ *  k-th leaf than the cutoff distance of the Gaussians, beyond which they
+ *  are below epsilon. Then choose for each of them the cheapest kind of
+ *  interaction, counting the terms each one sums. Expansions are only
+ *  used about leaves not larger than the boxes of the uniform transform.
+ */
+void FastGaussTransform3D::plan_leaf(uint_type k, vector<uint_type>& stack) {
+
+  const Node& leaf = nodes_[leaves_[k]];
+  vector<pair<uint_type, Interaction>>& interactions = interactions_[k];
+  interactions.clear();
+  taylor_[k] = 0;
+  if ( leaf.t_end == leaf.t_begin ) return;
+
+  const real_type box_size = 1.0f/N_side_;
+  const real_type cutoff2 = -delta_*log(epsilon_);
+
+  stack.clear();
+  stack.push_back(0);
+  while ( ! stack.empty() )
+  {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+    if ( node.s_end == node.s_begin ) continue;
+
+    real_type gap2 = 0.0;
+    for ( uint_type d = 0; d < d_; d++ ) {
+      real_type gap = fabs(node.center[d] - leaf.center[d]) - node.half - leaf.half;
+      if ( gap > 0 ) gap2 += gap*gap;
+    }
+    if ( gap2 > cutoff2 ) continue;
+
+    if ( node.nb_children == 0 ) {
+      interactions.push_back({node.children, DIRECT_DIRECT});
+    }
+    else {
+      for ( uint_type c = node.nb_children; c--; ) stack.push_back(node.children + c);
+    }
+  }
+
+  /* cost of each kind of interaction, in multiply-adds, an exponential
+   * (Gaussian or Hermite function) costing exp_cost of them */
+  const double exp_cost = exp_ratio();
+  const double M = leaf.t_end - leaf.t_begin;
+  const double p3 = p_*p_*p_;
+  const double infinity = INFINITY;
+  const bool target_expansion = 2*leaf.half <= box_size*1.0001f;
+  auto costs = [&](const pair<uint_type, Interaction>& interaction) {
+    const Node& source = nodes_[leaves_[interaction.first]];
+    const double N = source.s_end - source.s_begin;
+    const bool source_expansion = 2*source.half <= box_size*1.0001f;
+    return array<double, 4>{N*M*exp_cost,
+                            target_expansion ? N*(p3 + 3*exp_cost) : infinity,
+                            source_expansion ? M*(p3 + 3*exp_cost) : infinity,
+                            source_expansion && target_expansion ?
+                              3*p3*p_ + 3*(2*p_ - 1)*exp_cost : infinity};
+  };
+
+  /* the target leaf uses a Taylor series if the evaluation of the series
+   * is paid back */
+  double cost_direct = 0.0;
+  double cost_taylor = M*p3;     /* evaluation of the series */
+  for ( auto& interaction : interactions )
+  {
+    array<double, 4> cost = costs(interaction);
+    cost_direct += min(cost[DIRECT_DIRECT], cost[HERMITE_DIRECT]);
+    cost_taylor += *min_element(cost.begin(), cost.end());
+  }
+  const bool taylor = cost_taylor < cost_direct;
+
+  for ( auto& interaction : interactions )
+  {
+    array<double, 4> cost = costs(interaction);
+    if ( ! taylor ) {
+      cost[DIRECT_TAYLOR] = infinity;
+      cost[HERMITE_TAYLOR] = infinity;
+    }
+    interaction.second = static_cast<Interaction>(min_element(cost.begin(), cost.end()) - cost.begin());
+    if ( interaction.second == DIRECT_TAYLOR || interaction.second == HERMITE_TAYLOR )
+      taylor_[k] = 1;
+  }
+
+}
+
+/** gather_target_leaf: accumulate, at the targets of the k-th leaf, the
+ *  field of the source leaves in its interaction list. Only writes the
+ *  targets and the Taylor coefficients of this leaf.
+ */
+void FastGaussTransform3D::gather_target_leaf(uint_type k,
+                                              array<uint32_t, 4>& evals) {
+
+  const uint_type p3 = p_*p_*p_;
+  Box target = target_leaf(k);
+  real_type* B = &B_[k*p3];
+
+  for ( auto& interaction : interactions_[k] )
+  {
+    Box source = source_leaf(interaction.first);
+    const real_type* A = &A_[interaction.first*p3];
+    switch ( interaction.second )
+    {
+      case DIRECT_DIRECT :
+        direct_direct(source, target);
+        break;
+      case DIRECT_TAYLOR :
+        direct_taylor(source, target, B);
+        break;
+      case HERMITE_DIRECT :
+        hermite_direct(source, A, target);
+        break;
+      case HERMITE_TAYLOR :
+        hermite_taylor(source, A, target, B);
+        break;
+    }
+    evals.at(interaction.second)++;
+  }
+
+  /* evaluate Taylor expansion at target points */
+  if ( taylor_[k] )
+  {
+    taylor_evaluate(target, B);
+  }
+
+}
 
 void FastGaussTransform3D::finish_transform() {
 
-  unsigned int i = 0;
+  size_t c = 0;
   for (Cell* cell : *cell_list_) {
-    unsigned int nbr_targets = cell->gaussian_field_targets(signal_).size();
-    std::vector<real_type> value = std::vector<real_type>(G().begin() + i, G().begin() + i + nbr_targets);
-    cell->AddGaussianField(signal_, value); 
-    i += nbr_targets;
+    for ( uint_type k = 0; k < nb_signals_; k++ ) {
+      const pair<uint_type, uint_type>& targets = cell_targets_[c*nb_signals_ + k];
+      cell->AddGaussianField(signals_[k], &G_[(size_t) k*M_ + targets.first], targets.second);
+    }
+    c++;
   }
 
 
@@ -353,38 +1091,191 @@ void FastGaussTransform3D::finish_transform() {
   t_.clear();
   G_.clear();
   Gexact_.clear();
-  Bs_.clear();
-  Bt_.clear();
-  A_alpha_.clear();
-  ilist_.clear();
-  taylor_box_list_.clear();
-  non_empty_source_list_.clear(); 
-  non_empty_target_list_.clear(); 
-  non_empty_box_list_.clear(); 
 
 
 
 }
 
+/** direct_transform: direct sum over the pairs closer than the cutoff
+ *  radius, beyond which the Gaussians are below epsilon. The points are
+ *  sorted in a cell list, the Gaussians are computed by GaussKernel once for
+ *  all the signals. Target cells are processed concurrently, which gives the
+ *  same result whatever the number of threads.
+ */
 void FastGaussTransform3D::direct_transform() {
 
   if ( N_ == 0 ) { return; }
 
-  for ( uint_type_ i = 0; i < M_; i++)
+  direct_cell_list();
+  sort_points();
+
+  /* sorted weights and field, signal after signal */
+  sq_.resize((size_t) nb_signals_*N_);
+  for ( uint_type k = 0; k < nb_signals_; k++ ) {
+    const real_type* q = &q_[(size_t) k*N_];
+    real_type* sq = &sq_[(size_t) k*N_];
+    for ( uint_type i = 0; i < N_; i++ ) {
+      sq[i] = q[source_order_[i]];
+    }
+  }
+  Gs_.assign((size_t) nb_signals_*M_, 0.0);
+
+  const int32_t threads = Simulation::threads();
+  #pragma omp parallel if (threads > 1)
   {
-    for ( uint_type_ j = 0; j < N_; j++)
+    vector<real_type>& gauss = workspace().gauss;
+    #pragma omp for schedule(dynamic)
+    for ( size_t b = 0; b < target_boxes_.size(); b++ )
     {
-      G()[i] += q_[j]*exp(-dist2(s_[j],t_[i])/delta_);
+      direct_target_cell(b, gauss);
+    }
+  }
+
+  for ( uint_type k = 0; k < nb_signals_; k++ ) {
+    real_type* G = &G_[(size_t) k*M_];
+    const real_type* Gs = &Gs_[(size_t) k*M_];
+    for ( uint_type i = 0; i < M_; i++ ) {
+      G[target_order_[i]] = Gs[i];
     }
   }
 
 }
 
-/** form_interaction_list: list the indices of target boxes 
-  * around box i in a neighbourhood of size n around it.
-  * The list is stored in ls->l.
+/** direct_cell_list: sort the sources and the targets by cell of the direct
+ *  sum. A Gaussian is below epsilon beyond the cutoff radius
+ *  sqrt(-delta log epsilon). The cells are at least as large as this radius,
+ *  so that the sources in range of a target are in the 27 cells around its
+ *  own, and there are no more cells than points.
+ */
+void FastGaussTransform3D::direct_cell_list() {
+
+  expansion_order();  /* bound on epsilon */
+  direct_cutoff2_ = -delta_*log(epsilon_);
+  uint_type side = (uint_type) (1.0/sqrt(direct_cutoff2_));
+  uint_type max_side = (uint_type) cbrt((double) N_ + M_);
+  direct_side_ = max(min(side, max_side), (uint_type) 1);
+
+  sort_by_box(s_, direct_side_, source_start_, source_order_, source_boxes_);
+  sort_by_box(t_, direct_side_, target_start_, target_order_, target_boxes_);
+
+}
+
+/** direct_target_cell: accumulate, at the targets of the k-th non-empty
+ *  target cell, the Gaussians of the sources of the 27 cells around it.
+ *  Those cells form 9 runs of consecutive sources, one for each row along
+ *  x. Only writes the targets of this cell.
+ */
+void FastGaussTransform3D::direct_target_cell(uint_type k,
+                                              vector<real_type>& gauss)
+{
+  const uint_type n = direct_side_;
+  const uint_type c = target_boxes_[k];
+  uint_type ix = c % n;
+  uint_type iy = (c / n) % n;
+  uint_type iz = c / (n*n);
+  uint_type x0 = ix > 0 ? ix - 1 : 0;
+  uint_type x1 = min(ix + 1, n - 1);
+  uint_type y0 = iy > 0 ? iy - 1 : 0;
+  uint_type y1 = min(iy + 1, n - 1);
+  uint_type z0 = iz > 0 ? iz - 1 : 0;
+  uint_type z1 = min(iz + 1, n - 1);
+
+  for ( uint_type i = target_start_[c]; i < target_start_[c + 1]; i++ )
+  {
+    for ( uint_type kz = z0; kz <= z1; kz++ )
+    {
+      for ( uint_type ky = y0; ky <= y1; ky++ )
+      {
+        uint_type row = n*ky + n*n*kz;
+        uint_type begin = source_start_[row + x0];
+        uint_type end = source_start_[row + x1 + 1];
+        if ( begin == end ) continue;
+        if ( gauss.size() < end - begin ) gauss.resize(end - begin);
+
+        GaussKernel::Gaussians(end - begin, &sx_[begin], &sy_[begin], &sz_[begin],
+                               tx_[i], ty_[i], tz_[i], delta_, direct_cutoff2_,
+                               gauss.data());
+        for ( uint_type s = 0; s < nb_signals_; s++ )
+        {
+          const real_type* sq = &sq_[(size_t) s*N_ + begin];
+          real_type g = 0.0;
+          for ( uint_type j = 0; j < end - begin; j++ )
+          {
+            g += sq[j]*gauss[j];
+          }
+          Gs_[(size_t) s*M_ + i] += g;
+        }
+      }
+    }
+  }
+}
+
+/** direct_is_cheaper: whether the direct sum costs less than the uniform
+ *  fast transform, according to the cost model. The cost of the direct sum
+ *  is estimated from the occupancy of its cells, that of the fast
+ *  transform from the occupancy of the boxes, with the same choice of
+ *  interactions as gather_target_box
+ */
+bool FastGaussTransform3D::direct_is_cheaper() {
+
+  if ( N_ == 0 ) return true;
+
+  /* pairs of the direct sum: the targets of a cell and the sources of the
+   * cells around it */
+  const double e = exp_ratio();
+  direct_cell_list();
+  double pairs = 0.0;
+  const uint_type n = direct_side_;
+  for ( auto c : target_boxes_ ) {
+    uint_type ix = c % n, iy = (c / n) % n, iz = c / (n*n);
+    uint_type x0 = ix > 0 ? ix - 1 : 0, x1 = min(ix + 1, n - 1);
+    double sources = 0.0;
+    for ( uint_type kz = (iz > 0 ? iz - 1 : 0); kz <= min(iz + 1, n - 1); kz++ ) {
+      for ( uint_type ky = (iy > 0 ? iy - 1 : 0); ky <= min(iy + 1, n - 1); ky++ ) {
+        uint_type row = n*ky + n*n*kz;
+        sources += source_start_[row + x1 + 1] - source_start_[row + x0];
+      }
+    }
+    pairs += sources*(target_start_[c + 1] - target_start_[c]);
+  }
+  const double direct = pairs*e;
+
+  sort_by_box(s_, N_side_, source_start_, source_order_, source_boxes_);
+  sort_by_box(t_, N_side_, target_start_, target_order_, target_boxes_);
+
+  const double p3 = ipow(p_,d_);
+  double fast = 0.0;
+  for ( auto b : source_boxes_ ) {
+    double N_B = source_box(b).n();
+    if ( N_B >= N_F_ ) fast += N_B*(p3 + d_*e);      /* Hermite coefficients */
+  }
+  vector<uint_type>& ilist = workspaces_[0].list;
+  for ( auto b : target_boxes_ ) {
+    double Mc = target_box(b).n();
+    bool taylor = Mc > M_L_;
+    if ( taylor ) fast += Mc*p3;                      /* Taylor evaluation */
+    form_interaction_list(b, ilist);
+    for ( auto i : ilist ) {
+      double N_B = source_box(i).n();
+      if ( N_B == 0 ) continue;
+      if ( N_B < N_F_ )
+        fast += taylor ? N_B*(p3 + d_*e) : N_B*Mc*e;
+      else
+        fast += taylor ? d_*p3*p_ + d_*(2*p_ - 1)*e : Mc*(p3 + d_*e);
+    }
+    if ( fast > direct ) return true;
+  }
+  return false;
+
+}
+
+/** form_interaction_list: list the indices of boxes
+  * around box i in a neighbourhood of size n around it,
+  * in increasing order.
+  * The list is stored in ilist.
   */
-void FastGaussTransform3D::form_interaction_list(uint_type i)
+void FastGaussTransform3D::form_interaction_list(uint_type i,
+                                                 vector<uint_type>& ilist) const
 {
   uint_type ix = i % N_side_; /* center box in (i,j,k) coordinates */
   uint_type iy = (i / N_side_) % N_side_; /* center box in (i,j,k) coordinates */
@@ -397,7 +1288,7 @@ void FastGaussTransform3D::form_interaction_list(uint_type i)
   uint_type z1 = min(iz + n_, N_side_ - 1);
   // uint_type nn = (x1 - x0 + 1)*(y1 - y0 + 1)*(z1 - z0 + 1); /* nbr of n-neighbors */
 
-  ilist_.erase(ilist_.begin(),ilist_.end());
+  ilist.clear();
 
   for ( uint_type kz = z0; kz <= z1; kz++)
   {
@@ -405,28 +1296,130 @@ void FastGaussTransform3D::form_interaction_list(uint_type i)
     {
       for ( uint_type kx = x0; kx <= x1; kx++)
       {
-        ilist_.insert(kx + N_side_*ky + N_side_*N_side_*kz);
+        ilist.push_back(kx + N_side_*ky + N_side_*N_side_*kz);
+      }
+    }
+  }
+
+}
+
+/** gather_target_box: accumulate, at the targets of the k-th non-empty
+ *  target box, the field of the source boxes in range. Only writes the
+ *  targets and the Taylor coefficients of this box.
+ */
+void FastGaussTransform3D::gather_target_box(uint_type k,
+                                             vector<uint_type>& ilist,
+                                             array<uint32_t, 4>& evals)
+{
+  const uint_type p3 = p_*p_*p_;
+  Box target = target_box(target_boxes_[k]);
+  real_type* B = &B_[k*p3];                /* Taylor coefficients of the target box */
+  size_t Mc = target.n();                  /* nbr of targets in box */
+  bool taylor = false;                     /* whether the box has a Taylor series */
+
+  /* the interaction range is symmetric: the source boxes in range of
+   * the target box are the boxes in range of it */
+  form_interaction_list(target_boxes_[k], ilist);
+  for ( auto i : ilist )  /* range over source boxes in range */
+  {
+    Box source = source_box(i);
+    size_t N_B = source.n();                /* nbr sources in Box i */
+    if ( N_B == 0 ) continue;
+
+    if ( N_B < N_F_ )                          /* Source Box sends out N_B Gaussians */
+    {
+      if ( Mc <= M_L_ )                      /* few targets. C evaluates all fields immediately */
+      {
+        direct_direct(source, target);
+        evals.at(0)++;
+      }
+      else                                  /* Mc > M_L_: many targets. C transforms all fields to Taylor series */
+      {
+        /* direct_taylor accumulates the Taylor coefficients of the target box in B */
+        direct_taylor(source, target, B);
+        taylor = true;
+        evals.at(1)++;
       }
     }
+    else                                      /* B sends out a Hermite expansion */
+    {
+      /* Hermite coefficients of source box i */
+      size_t b = lower_bound(source_boxes_.begin(), source_boxes_.end(), i) - source_boxes_.begin();
+      const real_type* A = &A_[b*p3];
+      if ( Mc <= M_L_ )                      /* few targets. C evaluates all fields immediately */
+      {
+        /* direct evaluation of the _p-th order Hermite expansion */
+        hermite_direct(source, A, target);
+        evals.at(2)++;
+      }
+      else                                  /* Mc > M_L_: many targets. C transforms all fields to Taylor series */
+      {
+        /* accumulate Taylor coefficient from Hermite expansion */
+        hermite_taylor(source, A, target, B);
+        taylor = true;
+        evals.at(3)++;
+      }
+    }
+  }
+
+  /* evaluate Taylor expansion at target points */
+  if ( taylor )
+  {
+    taylor_evaluate(target, B);
   }
+}
+
+/** taylor_evaluate: evaluate the Taylor series _B_ of box _target_ at its
+ *  target points, accumulates the Gaussian field in _Gs_.
+ *  The monomials ((t-tC)/sqrt delta_)^beta are tensor products of 1D tables.
+ */
+void FastGaussTransform3D::taylor_evaluate(const Box& target, const real_type* B)
+{
+  const point_type& tC = target.center;
+  const real_type sqrt_delta = sqrt(delta_);
+  real_type mx[max_p_], my[max_p_], mz[max_p_];
 
+  for ( uint_type k = target.begin; k < target.end; k++ )   /* range over all targets in box */
+  {
+    monomials((tx_[k] - tC[0])/sqrt_delta, mx);
+    monomials((ty_[k] - tC[1])/sqrt_delta, my);
+    monomials((tz_[k] - tC[2])/sqrt_delta, mz);
+    real_type g = 0.0;
+    for ( uint_type beta1 = 0; beta1 < p_; beta1++)
+    {
+      real_type g1 = 0.0;
+      for ( uint_type beta2 = 0; beta2 < p_; beta2++)
+      {
+        const real_type* B12 = B + beta1*p_*p_ + beta2*p_;
+        real_type g2 = 0.0;
+        for ( uint_type beta3 = 0; beta3 < p_; beta3++)
+        {
+          g2 += B12[beta3]*mz[beta3];
+        }
+        g1 += g2*my[beta2];
+      }
+      g += g1*mx[beta1];
+    }
+    Gs_[k] += g;
+  }
 }
 
 /** direct_direct: direct evaluation of gaussian field from 
  *  box _source_ to box _target_. given sources _s_, targets _t_,
  *  and weights _q_.
  */
-void FastGaussTransform3D::direct_direct(Box3 source, Box3 target)
+void FastGaussTransform3D::direct_direct(const Box& source, const Box& target)
 {
-  for ( auto i : target.p() )
+  for ( uint_type i = target.begin; i < target.end; i++ )
   {
-    for (auto j : source.p() )
+    for ( uint_type j = source.begin; j < source.end; j++ )
     {
-      G_.at(i) += q_.at(j)*exp(-dist2(s_.at(j),t_.at(i))/delta_);
+      real_type dx = sx_[j] - tx_[i];
+      real_type dy = sy_[j] - ty_[i];
+      real_type dz = sz_[j] - tz_[i];
+      Gs_[i] += sq_[j]*exp(-(dx*dx + dy*dy + dz*dz)/delta_);
     }
   }
-
-  evals_.at(0)++;
 }
 
 
@@ -438,60 +1431,68 @@ void FastGaussTransform3D::direct_direct(Box3 source, Box3 target)
  *  G(t) = q*exp(-|t-s|^2/delta_)
  *  G(t) = sum_{beta>0} B_beta ((t-tc)/sqrt delta_)^beta
  *  B_beta = qj (-1)^|beta|/beta! h_beta((sj-tc)/sqrt delta_)
+ *  The 3D coefficients of each source are the tensor product of 
+ *  1D tables of h_beta/beta!.
  */
-void FastGaussTransform3D::direct_taylor(Box3 source, Box3& target)
+void FastGaussTransform3D::direct_taylor(const Box& source, const Box& target, real_type* B)
 {
-  real_type taylor_coeff;
+  const point_type& tC = target.center;
+  const real_type sqrt_delta = sqrt(delta_);
+  real_type hx[max_p_], hy[max_p_], hz[max_p_];
 
-  /* compute Taylor coefficients B */
-  for ( uint_type beta1 = 0; beta1 < p_; beta1++)  
+  /* accumulate Taylor coefficients B, one source at a time */
+  for ( uint_type j = source.begin; j < source.end; j++ )
   {
-    for ( uint_type beta2 = 0; beta2 < p_; beta2++)
+    hermite_functions((sx_[j] - tC[0])/sqrt_delta, hx);
+    hermite_functions((sy_[j] - tC[1])/sqrt_delta, hy);
+    hermite_functions((sz_[j] - tC[2])/sqrt_delta, hz);
+    for ( uint_type beta1 = 0; beta1 < p_; beta1++)  
     {
-      for ( uint_type beta3 = 0; beta3 < p_; beta3++)
+      real_type c1 = sq_[j]*hx[beta1];
+      for ( uint_type beta2 = 0; beta2 < p_; beta2++)
       {
-        taylor_coeff = 0.0;
-        for ( auto j : source.p() )
+        real_type c2 = c1*hy[beta2];
+        real_type* B12 = B + beta1*p_*p_ + beta2*p_;
+        for ( uint_type beta3 = 0; beta3 < p_; beta3++)
         {
-          taylor_coeff += q_.at(j)*Hermite::Function((s_.at(j).at(0) - target.center().at(0))/sqrt(delta_),beta1)* \
-                                   Hermite::Function((s_.at(j).at(1) - target.center().at(1))/sqrt(delta_),beta2)* \
-                                   Hermite::Function((s_.at(j).at(2) - target.center().at(2))/sqrt(delta_),beta3);
+          B12[beta3] += c2*hz[beta3]; /* accumulate Taylor coefficient in B for later evaluation */
         }
-        taylor_coeff /= factorial_[beta1]*factorial_[beta2]*factorial_[beta3];
-        target.B().at(beta1*p_*p_ + beta2*p_ + beta3) += taylor_coeff; /* accumulate Taylor coefficient in B for later evaluation */
       }
     }
   }
-
-  evals_.at(1)++;
 }
 
 
 /** hermite_coeffs
- * Compute Hermite expansion up to order p_ - 1 at source _box_,
+ * Compute Hermite expansion up to order p_ - 1 at box _source_,
  * given sources _s_, weights _q_, box center _sB_.
- * Coefficients are stored in A.
+ * Coefficients are stored in _A_. The coefficients of each source are
+ * the tensor product of 1D tables of ((s-sB)/sqrt delta_)^alpha/alpha!.
  */
-void FastGaussTransform3D::hermite_coeffs(Box3 source)
+void FastGaussTransform3D::hermite_coeffs(const Box& source, real_type* A)
 {
-  real_type a;
+  const point_type& sB = source.center;
+  const real_type sqrt_delta = sqrt(delta_);
+  real_type mx[max_p_], my[max_p_], mz[max_p_];
 
   /* form Hermite coefficients O(p^d*N) */
-  for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++)  
+  fill(A, A + p_*p_*p_, 0.0);
+  for ( uint_type j = source.begin; j < source.end; j++ ) /* range over source points in source box */
   {
-    for ( uint_type alpha2 = 0; alpha2 < p_; alpha2++)
+    monomials((sx_[j] - sB[0])/sqrt_delta, mx);
+    monomials((sy_[j] - sB[1])/sqrt_delta, my);
+    monomials((sz_[j] - sB[2])/sqrt_delta, mz);
+    for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++)  
     {
-      for ( uint_type alpha3 = 0; alpha3 < p_; alpha3++)
+      real_type c1 = sq_[j]*mx[alpha1]/factorial_[alpha1];
+      for ( uint_type alpha2 = 0; alpha2 < p_; alpha2++)
       {
-        a = 0.0;
-        for ( auto j : source.p() ) /* range over source points in source box */
+        real_type c2 = c1*my[alpha2]/factorial_[alpha2];
+        real_type* A12 = A + alpha1*p_*p_ + alpha2*p_;
+        for ( uint_type alpha3 = 0; alpha3 < p_; alpha3++)
         {
-          a += q_.at(j)*ipow((s_.at(j).at(0) - source.center().at(0))/sqrt(delta_),alpha1)* \
-                        ipow((s_.at(j).at(1) - source.center().at(1))/sqrt(delta_),alpha2)* \
-                        ipow((s_.at(j).at(2) - source.center().at(2))/sqrt(delta_),alpha3);
+          A12[alpha3] += c2*mz[alpha3]/factorial_[alpha3];
         }
-        a /= (factorial_[alpha1]*factorial_[alpha2]*factorial_[alpha3]);
-        A_alpha_.at(alpha1*p_*p_ + alpha2*p_ + alpha3) = a;
       }
     }
   }
@@ -499,77 +1500,113 @@ void FastGaussTransform3D::hermite_coeffs(Box3 source)
 
 /** hermite_direct: Evaluate the Hermite expansion at each target point
  * in box _target_, with targets _t_, from the Hermite expansion of 
- * source box with center _sB_, and Hermite coefficients _A_alpha_. Accumulates
- * the Gaussian field in _G_.
+ * box _source_, with center _sB_ and Hermite coefficients _A_. Accumulates
+ * the Gaussian field in _Gs_.
  * G(t) = Sum_sourceBoxe Sum_sourcePoint A_alpha Hermite::Function(t - s_B) 
  * Few targets, many sources.
  */
-void FastGaussTransform3D::hermite_direct(point_type sB, Box3 target )
+void FastGaussTransform3D::hermite_direct(const Box& source, const real_type* A, const Box& target)
 {
-  real_type c1, c2, c3;
+  const point_type& sB = source.center;
+  const real_type sqrt_delta = sqrt(delta_);
+  H_Real hx[max_p_], hy[max_p_], hz[max_p_];
 
   /* evaluate the Hermite series */
-  for ( auto i : target.p() )   /* range over all targets in target box */
+  for ( uint_type i = target.begin; i < target.end; i++ )   /* range over all targets in target box */
   {
+    Hermite::Functions((tx_[i] - sB[0])/sqrt_delta, p_, hx);
+    Hermite::Functions((ty_[i] - sB[1])/sqrt_delta, p_, hy);
+    Hermite::Functions((tz_[i] - sB[2])/sqrt_delta, p_, hz);
+    real_type g = 0.0;
     for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++)  
     {
-      c1 = Hermite::Function((t_.at(i).at(0) - sB.at(0))/sqrt(delta_),alpha1);
+      real_type g1 = 0.0;
       for ( uint_type alpha2 = 0; alpha2 < p_; alpha2++)
       {
-        c2 = Hermite::Function((t_.at(i).at(1) - sB.at(1))/sqrt(delta_),alpha2);
+        const real_type* A12 = A + alpha1*p_*p_ + alpha2*p_;
+        real_type g2 = 0.0;
         for ( uint_type alpha3 = 0; alpha3 < p_; alpha3++)
         {
-          c3 = Hermite::Function((t_.at(i).at(2) - sB.at(2))/sqrt(delta_),alpha3);
-          G_.at(i) += A_alpha_.at(alpha1*p_*p_ + alpha2*p_ + alpha3)*c1*c2*c3;
+          g2 += A12[alpha3]*hz[alpha3];
         }
+        g1 += g2*hy[alpha2];
       }
+      g += g1*hx[alpha1];
     }
+    Gs_[i] += g;
   }
-
-  evals_.at(2)++;
 }
 
 /** hermite_taylor: accumulate taylor coefficients into array _B_ 
  * from precomputed Hermite expansion _A_ 
- * of box centered at _sB_, and target box centered at _tC_ 
+ * of box _source_ centered at _sB_, and target box centered at _tC_ 
  * Many sources, many targets
+ * B_beta = (-1)^|beta|/beta! Sum_alpha A_alpha h_{alpha+beta}(tC - sB)
+ * is contracted one dimension at a time, O(d*p^(d+1)).
  */
-void FastGaussTransform3D::hermite_taylor(Box3& target, point_type sB)
+void FastGaussTransform3D::hermite_taylor(const Box& source, const real_type* A,
+                                          const Box& target, real_type* B)
 {
-  real_type taylor_coeff;
-  vector<real_type> h1(2*p_ - 1, 0.0);
-  vector<real_type> h2(2*p_ - 1, 0.0);
-  vector<real_type> h3(2*p_ - 1, 0.0);
+  const point_type& sB = source.center;
+  const point_type& tC = target.center;
+  const real_type sqrt_delta = sqrt(delta_);
+  const uint_type p2 = p_*p_;
+  H_Real h1[2*max_p_ - 1];
+  H_Real h2[2*max_p_ - 1];
+  H_Real h3[2*max_p_ - 1];
+  real_type T1[max_p_*max_p_*max_p_];  /* T1[alpha1][alpha2][beta3] */
+  real_type T2[max_p_*max_p_*max_p_];  /* T2[alpha1][beta2][beta3] */
 
   /* precompute Hermite functions h_{alpha + beta} */
-  for ( uint_type k = 0; k < 2*p_ - 1; k++ )
+  /* in the paper, the argument of Hermite::Function is inverted: sB - tC instead of tC - sB */
+  Hermite::Functions((tC[0] - sB[0])/sqrt_delta, 2*p_ - 1, h1);
+  Hermite::Functions((tC[1] - sB[1])/sqrt_delta, 2*p_ - 1, h2);
+  Hermite::Functions((tC[2] - sB[2])/sqrt_delta, 2*p_ - 1, h3);
+
+  /* contract alpha3 */
+  for ( uint_type a12 = 0; a12 < p2; a12++ )
   {
-    /* in the paper, the argument of Hermite::Function is inverted: sB - tC instead of tC - sB */
-    h1.at(k) = Hermite::Function((target.center().at(0) - sB.at(0))/sqrt(delta_),k);
-    h2.at(k) = Hermite::Function((target.center().at(1) - sB.at(1))/sqrt(delta_),k);
-    h3.at(k) = Hermite::Function((target.center().at(2) - sB.at(2))/sqrt(delta_),k);
+    for ( uint_type beta3 = 0; beta3 < p_; beta3++ )
+    {
+      real_type t = 0.0;
+      for ( uint_type alpha3 = 0; alpha3 < p_; alpha3++ )
+      {
+        t += A[a12*p_ + alpha3]*h3[alpha3 + beta3];
+      }
+      T1[a12*p_ + beta3] = t;
+    }
   }
 
-  /* compute Taylor coefficients B O(d*p^(d+1))?? */
-  for ( uint_type beta1 = 0; beta1 < p_; beta1++)  
+  /* contract alpha2 */
+  for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++ )
   {
-    for ( uint_type beta2 = 0; beta2 < p_; beta2++)
+    for ( uint_type beta2 = 0; beta2 < p_; beta2++ )
     {
-      for ( uint_type beta3 = 0; beta3 < p_; beta3++)
+      real_type* T2_12 = T2 + alpha1*p2 + beta2*p_;
+      fill(T2_12, T2_12 + p_, 0.0);
+      for ( uint_type alpha2 = 0; alpha2 < p_; alpha2++ )
       {
-        taylor_coeff = 0.0;
-        for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++)  
+        const real_type h = h2[alpha2 + beta2];
+        const real_type* T1_12 = T1 + alpha1*p2 + alpha2*p_;
+        for ( uint_type beta3 = 0; beta3 < p_; beta3++ )
         {
-          for ( uint_type alpha2 = 0; alpha2 < p_; alpha2++)
-          {
-            for ( uint_type alpha3 = 0; alpha3 < p_; alpha3++)
-            {
-              taylor_coeff += A_alpha_.at(alpha1*p_*p_ + alpha2*p_ + alpha3)* \
-                              h1[alpha1 + beta1]* \
-                              h2[alpha2 + beta2]* \
-                              h3[alpha3 + beta3];
-            }
-          }
+          T2_12[beta3] += T1_12[beta3]*h;
+        }
+      }
+    }
+  }
+
+  /* contract alpha1, accumulate Taylor coefficients in B for later evaluation */
+  for ( uint_type beta1 = 0; beta1 < p_; beta1++ )
+  {
+    for ( uint_type beta2 = 0; beta2 < p_; beta2++ )
+    {
+      for ( uint_type beta3 = 0; beta3 < p_; beta3++ )
+      {
+        real_type taylor_coeff = 0.0;
+        for ( uint_type alpha1 = 0; alpha1 < p_; alpha1++ )
+        {
+          taylor_coeff += T2[alpha1*p2 + beta2*p_ + beta3]*h1[alpha1 + beta1];
         }
 
         if ( (beta1 + beta2 + beta3) % 2 )
@@ -577,14 +1614,34 @@ void FastGaussTransform3D::hermite_taylor(Box3& target, point_type sB)
 
         taylor_coeff /= (factorial_[beta1]*factorial_[beta2]*factorial_[beta3]);
 
-        target.B().at(beta1*p_*p_ + beta2*p_ + beta3) += taylor_coeff; /* accumulate Taylor coefficient in B for later evaluation */
+        B[beta1*p2 + beta2*p_ + beta3] += taylor_coeff;
       }
     }
   }
+}
 
-  evals_.at(3)++;
+/** hermite_functions: 1D table of h_k(t)/k! for k < p_,
+ *  with h_k the Hermite functions
+ */
+void FastGaussTransform3D::hermite_functions(real_type t, real_type* h) const
+{
+  H_Real hk[max_p_];
+  Hermite::Functions(t, p_, hk);
+  for ( uint_type k = 0; k < p_; k++ )
+  {
+    h[k] = hk[k]/factorial_[k];
+  }
 }
 
+/** monomials: 1D table of t^k for k < p_ */
+void FastGaussTransform3D::monomials(real_type t, real_type* m) const
+{
+  m[0] = 1.0;
+  for ( uint_type k = 1; k < p_; k++ )
+  {
+    m[k] = m[k - 1]*t;
+  }
+}
 
 real_type FastGaussTransform3D::ipow(const real_type x, uint_type n) {
 
@@ -597,7 +1654,7 @@ real_type FastGaussTransform3D::ipow(const real_type x, uint_type n) {
 
 }
 
-real_type FastGaussTransform3D::dist2(point_type p1, point_type p2)
+real_type FastGaussTransform3D::dist2(const point_type& p1, const point_type& p2)
 {
   return  (p1.at(0) - p2.at(0))*(p1.at(0) - p2.at(0)) + \
           (p1.at(1) - p2.at(1))*(p1.at(1) - p2.at(1)) + \
@@ -605,14 +1662,55 @@ real_type FastGaussTransform3D::dist2(point_type p1, point_type p2)
 }
 
 
+/** box_center: returns the coordinates of the center of box b */
+point_type FastGaussTransform3D::box_center(uint_type b) const
+{
+  return { (b % N_side_ + 0.5f)/N_side_,
+           ( (b / N_side_) % N_side_ + 0.5f)/N_side_,
+           (b / (N_side_*N_side_) + 0.5f)/N_side_};
+}
+
+/** sort_by_box: counting sort of the points by box. On return, the points
+ *  of box b are order[start[b]] to order[start[b + 1] - 1], in increasing
+ *  order, and boxes lists the non-empty boxes in increasing order.
+ */
+void FastGaussTransform3D::sort_by_box(const vector<point_type>& points,
+                                       uint_type side,
+                                       vector<uint_type>& start,
+                                       vector<uint_type>& order,
+                                       vector<uint_type>& boxes)
+{
+  uint_type nb_boxes = side*side*side;
+  vector<uint_type>& box = box_;
+  box.resize(points.size());
+
+  start.assign(nb_boxes + 1, 0);
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    box[i] = p2b(points[i], side);
+    start[box[i] + 1]++;
+  }
+  boxes.clear();
+  for ( uint_type b = 0; b < nb_boxes; b++ ) {
+    if ( start[b + 1] > 0 ) boxes.push_back(b);
+    start[b + 1] += start[b];
+  }
+
+  vector<uint_type>& cursor = cursor_;
+  cursor.assign(start.begin(), start.end() - 1);
+  order.resize(points.size());
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    order[cursor[box[i]]++] = i;
+  }
+}
+
 /** p2b: returns the box linear index containing point p */
-uint_type FastGaussTransform3D::p2b(point_type p)
+uint_type FastGaussTransform3D::p2b(point_type p, uint_type side)
 {
-  size_t ix = (size_t)(N_side_*p.at(0));
-  size_t iy = (size_t)(N_side_*p.at(1));
-  size_t iz = (size_t)(N_side_*p.at(2));
-  size_t b = ix + N_side_*iy + N_side_*N_side_*iz;
-  if ( b < N_side_*N_side_*N_side_ )
+  size_t ix = (size_t)(side*p.at(0));
+  size_t iy = (size_t)(side*p.at(1));
+  size_t iz = (size_t)(side*p.at(2));
+  size_t b = ix + side*iy + side*side*iz;
+  if ( b < side*side*side )
   {
     return b;
   }
@@ -634,8 +1732,14 @@ void FastGaussTransform3D::Save(gzFile backup_file) const {
     gzwrite(backup_file,&int_sig,sizeof(int_sig)); 
     gzwrite(backup_file, &diffusive_delta_[i], sizeof(diffusive_delta_[i]));
     gzwrite(backup_file, &diffusive_epsilon_[i], sizeof(diffusive_epsilon_[i]));
+    uint8_t solver = static_cast<uint8_t>(diffusive_solver_[i]);
+    gzwrite(backup_file, &solver, sizeof(solver));
     i++;
   }
+  uint8_t tuned = tuned_;
+  gzwrite(backup_file, &tuned, sizeof(tuned));
+  gzwrite(backup_file, &madd_cost_, sizeof(madd_cost_));
+  gzwrite(backup_file, &exp_cost_, sizeof(exp_cost_));
 }
 
 void FastGaussTransform3D::Load(gzFile backup_file) {
@@ -650,7 +1754,16 @@ void FastGaussTransform3D::Load(gzFile backup_file) {
     diffusive_delta_.push_back(val);
     gzread(backup_file, &val, sizeof(val));
     diffusive_epsilon_.push_back(val);
+    uint8_t solver;
+    gzread(backup_file, &solver, sizeof(solver));
+    diffusive_solver_.push_back(static_cast<DiffusionSolver>(solver));
   }
+  uint8_t tuned;
+  gzread(backup_file, &tuned, sizeof(tuned));
+  tuned_ = tuned;
+  gzread(backup_file, &madd_cost_, sizeof(madd_cost_));
+  gzread(backup_file, &exp_cost_, sizeof(exp_cost_));
+  group_signals();
 
 }
 
@@ -38,13 +38,19 @@
 
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
 #include <vector>
 #include <array>
-#include <set>
 #include <stdint.h>
+#include <complex>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "Hermite.h"
-#include "Box3.h"
+#include "GaussKernel.h"
+#include "DiffusionSolver.h"
+#include "Fft.h"
 #include "Simulation.h"
 
 using namespace std;
@@ -84,9 +90,14 @@ class FastGaussTransform3D {
   // ==========================================================================
 
   void Setup(const SimulationParams& simParams);
-  void init_transform(InterCellSignal signal);
+  void SetupCosts(const string& costs, const string& output_dir);
+  void calibrate();
+  void init_transform(const vector<InterCellSignal>& signals);
   void fast_transform();
+  void adaptive_transform();
+  void mesh_transform();
   void direct_transform();
+  bool direct_is_cheaper();
   void finish_transform();
 
   void Save(gzFile backup_file) const;
@@ -95,11 +106,18 @@ class FastGaussTransform3D {
   // ==========================================================================
   //                                Accessors
   // ==========================================================================
+  /** Field of the k-th signal at the i-th target: G()[k*M + i] */
   vector<real_type_>& G() { return G_; };
   vector<real_type_>& Gexact() { return Gexact_; };
   array<uint32_t, 4>& evals() { return evals_; };
   const list<InterCellSignal>& using_diffusive_signals() const { return using_diffusive_signals_; }
+  /** Diffusive signals with the same delta, epsilon and solver */
+  const vector<vector<InterCellSignal>>& signal_groups() const { return signal_groups_; }
   real_type_ delta() { return delta_; }
+  DiffusionSolver solver() const { return solver_; }
+  bool tuned() const { return tuned_; }
+  double madd_cost() const { return madd_cost_; }
+  double exp_cost() const { return exp_cost_; }
 
   // ==========================================================================
   //                               Attributes
@@ -117,31 +135,112 @@ class FastGaussTransform3D {
   // ==========================================================================
 
   static constexpr uint_type_   d_ = 3;         /* space dimension */
+  static constexpr uint_type_   max_p_ = 11;    /* maximal expansion order */
+  static constexpr uint_type_   max_window_ = 8; /* maximal half-width of the mesh spreading window */
+
+  /** Points of a box: begin to end - 1 in the sorted arrays, and its center */
+  struct Box {
+    uint_type_ begin;
+    uint_type_ end;
+    point_type_ center;
+    uint_type_ n() const { return end - begin; }
+  };
+
+  /** Interaction between a source box and a target box, the values are
+   * the indices in evals_ */
+  enum Interaction : uint8_t {
+    DIRECT_DIRECT = 0,     /* sources evaluated at targets */
+    DIRECT_TAYLOR = 1,     /* sources to the Taylor series of the target box */
+    HERMITE_DIRECT = 2,    /* Hermite series of the source box at targets */
+    HERMITE_TAYLOR = 3     /* Hermite series to Taylor series */
+  };
+
+  /** Node of the octree of the adaptive transform: a cube and the sources
+   * and targets it contains. Children are consecutive in nodes_ */
+  struct Node {
+    point_type_ center;
+    real_type_ half;         /* half of the side of the cube */
+    uint_type_ s_begin;
+    uint_type_ s_end;
+    uint_type_ t_begin;
+    uint_type_ t_end;
+    uint_type_ children;     /* index of the first child */
+    uint_type_ nb_children;  /* 0 for leaves */
+  };
+
   uint_type_  N_;
   uint_type_  M_;
+  uint_type_  nb_signals_ = 1;                  /* nbr of weights of each source */
   uint_type_  N_side_;                          /* nbr box in each dimensions */
   real_type_  r_;                               /* r largest value < 1/2 such that N_side is a integer */
   uint_type_  n_;                               /* nbr box span in each direction */
   uint_type_  p_;
 
+  uint_type_  direct_side_;                     /* nbr cells in each dimension of the direct sum */
+  real_type_  direct_cutoff2_;                  /* square of the cutoff radius of the direct sum */
+
   uint_type_  N_F_;                             /* N_F = O(_p^(d-1)) Cut-off for number of sources per box */
   uint_type_  M_L_;                             /* M_L = O(_p^(d-1)) Cut-off for number of targets per box */
 
-  vector<Box3> Bs_;                              /* array of lists of source points in each box */
-  vector<Box3> Bt_;                              /* array of lists of target points in each box */
-
-  vector<real_type_>  A_alpha_;                   /* Hermite Coeffs */
-
-  set<uint32_t>    ilist_; 
-  set<uint32_t>    taylor_box_list_; 
-  set<uint32_t>    non_empty_source_list_; 
-  set<uint32_t>    non_empty_target_list_; 
-  set<uint32_t>    non_empty_box_list_; 
+  /* Sources and targets sorted by box, in compressed sparse row layout:
+   * the points of box b are at positions start_[b] to start_[b + 1] - 1
+   * of the sorted coordinate arrays */
+  vector<uint_type_>  source_start_;
+  vector<uint_type_>  target_start_;
+  vector<real_type_>  sx_;
+  vector<real_type_>  sy_;
+  vector<real_type_>  sz_;
+  vector<real_type_>  sq_;                      /* weights of the selected signal */
+  vector<real_type_>  tx_;
+  vector<real_type_>  ty_;
+  vector<real_type_>  tz_;
+  vector<uint_type_>  source_order_;            /* index in s_ of the sorted sources */
+  vector<uint_type_>  target_order_;            /* index in t_ of the sorted targets */
+  vector<real_type_>  Gs_;                      /* field at the sorted targets */
+
+  /* non-empty boxes, in increasing order */
+  vector<uint_type_>  source_boxes_;
+  vector<uint_type_>  target_boxes_;
+
+  vector<real_type_>  A_;                       /* Hermite coefficients, p^3 per non-empty source box */
+  vector<real_type_>  B_;                       /* Taylor coefficients, p^3 per non-empty target box */
+
+  /* Octree of the adaptive transform: only occupied cubes are subdivided,
+   * down to the size of the boxes of the uniform transform. Its leaves, in
+   * depth-first order, and for each leaf the source leaves it interacts
+   * with, in the same order, and how */
+  vector<Node>        nodes_;
+  vector<uint_type_>  leaves_;
+  vector<vector<pair<uint_type_, Interaction>>> interactions_;
+  vector<uint8_t>     taylor_;                  /* whether a leaf uses a Taylor series */
+  vector<uint8_t>     hermite_;                 /* whether a leaf sends out a Hermite series */
+
+  /* Mesh of the mesh transform: n^3 nodes spaced by h covering the unit
+   * cube and the spreading windows around it, node (i,j,k) at index
+   * i + n*j + n*n*k, and the spectrum of the mesh Gaussian */
+  vector<real_type_>  mesh_;
+  vector<double>      spectrum_;
+  Fft                 fft_;
+
+  /** Scratch space of a thread */
+  struct Workspace {
+    vector<uint_type_>       list;    /* interaction list or octree stack */
+    vector<complex<double>>  line;    /* mesh line being convolved */
+    vector<real_type_>       gauss;   /* Gaussians of a run of sources (direct sum) */
+  };
+
+  /* Workspaces: like all the arrays above, they keep their capacity from
+   * one transform to the next, so that steady-state steps do not allocate */
+  vector<Workspace>   workspaces_;              /* one per thread */
+  vector<uint_type_>  buffer_;                  /* octree construction */
+  vector<uint_type_>  box_;                     /* box of each point (sort_by_box) */
+  vector<uint_type_>  cursor_;                  /* (sort_by_box) */
+  vector<real_type_>  source_weights_;          /* weights, source after source */
+  vector<vector<Coordinates<double>>> signal_targets_; /* targets of a cell */
 
-  
   vector<real_type_>  G_;
   vector<real_type_>  Gexact_;
-  vector<real_type_>  q_;
+  vector<real_type_>  q_;                       /* weights of the sources, signal after signal */
   vector<point_type_>  s_;
   vector<point_type_>  t_;
 
@@ -154,53 +253,184 @@ class FastGaussTransform3D {
 
 
   // cell list from Simulation
-  const list<Cell*>* cell_list_; 
+  const SlotMap<Cell*>* cell_list_; 
 
   /** Intercellular signals used as diffusive (long-range) signals */
   list<InterCellSignal> using_diffusive_signals_;
   vector<real_type_> diffusive_delta_;
   vector<real_type_> diffusive_epsilon_;
-
-  InterCellSignal signal_;
+  vector<DiffusionSolver> diffusive_solver_;
+
+  /** Signals being transformed, and for each cell and signal the first
+   * target and the number of targets in t_ */
+  vector<InterCellSignal> signals_;
+  vector<pair<uint_type_, uint_type_>> cell_targets_;
+  vector<vector<InterCellSignal>> signal_groups_;
+  DiffusionSolver solver_ = DiffusionSolver::UNIFORM;
+
+  /* Cost model of the kernels: the time of a kernel is madd_cost_ times its
+   * number of multiply-adds plus exp_cost_ times its number of exponentials
+   * (Gaussians and tables of Hermite functions). The default only fixes
+   * their ratio; once tuned (measured on this machine) it also sets the
+   * expansion thresholds and the choice of the direct sum */
+  double madd_cost_ = 1.0;
+  double exp_cost_ = 16.0;
+  bool tuned_ = false;
+  static constexpr const char* costs_file_name_ = "fgt_costs.txt";
 
  private:
   // ==========================================================================
   //                            Private Methods
   // ==========================================================================
 
-  /* return index of box containing point p */
-  uint_type_ p2b(point_type_ p); 
+  /* return index of box containing point p, on a grid of side boxes in
+   * each dimension */
+  uint_type_ p2b(point_type_ p, uint_type_ side);
+
+  /* return the center of box b */
+  point_type_ box_center(uint_type_ b) const;
+
+  /** Sort points by box, on a grid of side boxes in each dimension: CSR
+   * offsets, order of the sorted points and list of non-empty boxes */
+  void sort_by_box(const vector<point_type_>& points, uint_type_ side,
+                   vector<uint_type_>& start, vector<uint_type_>& order,
+                   vector<uint_type_>& boxes);
+
+  /** Cost of an exponential in multiply-adds */
+  double exp_ratio() const { return exp_cost_/madd_cost_; }
+
+  /** Write the cost model to, or read it from, _file_ */
+  void write_costs(const string& file) const;
+  void read_costs(const string& file);
+
+  /** Group the diffusive signals that can be transformed together */
+  void group_signals();
 
   /** space renormalization */
   void renormalize();
 
+  /** Rescale the points and size the boxes */
+  void scale_transform();
+
+  /** Choose the expansion order and the interaction range from epsilon */
+  void expansion_order();
+
+  /** Sort the sources and targets in the cell list of the direct sum */
+  void direct_cell_list();
+
+  /** Sum of the sources in range of the targets of the k-th non-empty
+   * cell of the direct sum */
+  void direct_target_cell(uint_type_ k, vector<real_type_>& gauss);
+
+  /** Copy the sources and targets in the sorted arrays */
+  void sort_points();
+
+  /** Workspace of the calling thread */
+  Workspace& workspace() {
+#ifdef _OPENMP
+    return workspaces_[omp_get_thread_num()];
+#else
+    return workspaces_[0];
+#endif
+  }
+
+  /** Whether a source emits the k-th signal */
+  bool emits(uint_type_ k) const;
+
+  /** Sorted weights of the k-th signal */
+  void select_signal(uint_type_ k);
+
+  /** Back to the order of the targets, in the field of the k-th signal */
+  void scatter_field(uint_type_ k);
+
+  /** Field of the selected signal, on the boxes or on the octree */
+  void fast_evaluate();
+  void adaptive_evaluate();
+
+  /** Build the octree below node, sorting its points in source_order and
+   * target_order */
+  void build_octree(uint_type_ node, vector<uint_type_>& source_order,
+                    vector<uint_type_>& buffer);
+
+  /** Split the points begin to end - 1 of order by octant around center,
+   * stable. Returns the start of the points of each octant */
+  array<uint_type_, 9> split_octants(const vector<point_type_>& points,
+                                     const point_type_& center,
+                                     uint_type_ begin, uint_type_ end,
+                                     vector<uint_type_>& order,
+                                     vector<uint_type_>& buffer) const;
+
+  /** List the source leaves in range of the k-th leaf and choose how they
+   * interact with it */
+  void plan_leaf(uint_type_ k, vector<uint_type_>& stack);
+
+  /** Sources and targets of the k-th leaf */
+  Box source_leaf(uint_type_ k) const {
+    const Node& node = nodes_[leaves_[k]];
+    return {node.s_begin, node.s_end, node.center};
+  }
+  Box target_leaf(uint_type_ k) const {
+    const Node& node = nodes_[leaves_[k]];
+    return {node.t_begin, node.t_end, node.center};
+  }
+
+  /** Sources and targets of box b of the uniform grid */
+  Box source_box(uint_type_ b) const {
+    return {source_start_[b], source_start_[b + 1], box_center(b)};
+  }
+  Box target_box(uint_type_ b) const {
+    return {target_start_[b], target_start_[b + 1], box_center(b)};
+  }
+
 
 
   /** integral power */
-  real_type_ ipow(const real_type_ x, uint_type_ n);
+  static real_type_ ipow(const real_type_ x, uint_type_ n);
+
+  /** 1D table of Hermite functions h_k(t)/k!, k < p_ */
+  void hermite_functions(real_type_ t, real_type_* h) const;
+
+  /** 1D table of monomials t^k, k < p_ */
+  void monomials(real_type_ t, real_type_* m) const;
 
   /** square norm of difference between p1 and p2 */
-  real_type_ dist2(point_type_ p1, point_type_ p2);
+  static real_type_ dist2(const point_type_& p1, const point_type_& p2);
+
 
+  /** form_interaction_list: list the indices of the boxes in range */
+  void form_interaction_list(uint_type_ i, vector<uint_type_>& ilist) const;
 
-  /** form_interaction_list: list the indices of target boxes */
-  void form_interaction_list(uint_type_ i);
+  /** Gather the field of all the source boxes in range at the k-th
+   * non-empty target box */
+  void gather_target_box(uint_type_ k, vector<uint_type_>& ilist,
+                         array<uint32_t, 4>& evals);
 
+  /** Convolve the mesh with the 1D kernel whose spectrum is given along
+   * one axis (0: x, 1: y, 2: z) */
+  void convolve_axis(uint_type_ n, uint_type_ axis,
+                     const vector<double>& spectrum);
+
+  /** Gather the field of the source leaves in range at the k-th leaf */
+  void gather_target_leaf(uint_type_ k, array<uint32_t, 4>& evals);
 
   /** Direct summation of sources, direct evaluation at targets */
-  void direct_direct(Box3 source, Box3 target);
+  void direct_direct(const Box& source, const Box& target);
 
   /** Transform all field to Taylor series */
-  void direct_taylor(Box3 source, Box3& target);
+  void direct_taylor(const Box& source, const Box& target, real_type_* B);
 
   /** Compute Hermite expansion */
-  void hermite_coeffs(Box3 source);
+  void hermite_coeffs(const Box& source, real_type_* A);
 
   /** Truncated Hermite expansion, direct evaluation */
-  void hermite_direct(point_type_ sB, Box3 target );
+  void hermite_direct(const Box& source, const real_type_* A, const Box& target);
 
   /** Truncated Hermite expansion to Taylor series */
-  void hermite_taylor(Box3& target, point_type_ sB);
+  void hermite_taylor(const Box& source, const real_type_* A, const Box& target,
+                      real_type_* B);
+
+  /** Evaluate the Taylor series of the target box at its targets */
+  void taylor_evaluate(const Box& target, const real_type_* B);
 
   // ==========================================================================
   //                            Private Attributes
@@ -0,0 +1,83 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+/* Fft.cpp */
+
+#include "Fft.h"
+
+#include <cmath>
+#include <utility>
+
+Fft::Fft(uint32_t size) : size_(size), reversed_(size), twiddles_(size/2) {
+  uint32_t bits = 0;
+  while ( (1u << bits) < size ) bits++;
+  for ( uint32_t i = 0; i < size; i++ ) {
+    uint32_t r = 0;
+    for ( uint32_t b = 0; b < bits; b++ ) {
+      if ( i & (1u << b) ) r |= 1u << (bits - 1 - b);
+    }
+    reversed_[i] = r;
+  }
+  for ( uint32_t k = 0; k < size/2; k++ ) {
+    twiddles_[k] = std::polar(1.0, -2*M_PI*k/size);
+  }
+}
+
+uint32_t Fft::Size(uint32_t n) {
+  uint32_t size = 1;
+  while ( size < n ) size *= 2;
+  return size;
+}
+
+void Fft::Forward(std::complex<double>* data) const {
+  Transform(data, false);
+}
+
+void Fft::Inverse(std::complex<double>* data) const {
+  Transform(data, true);
+  for ( uint32_t i = 0; i < size_; i++ ) {
+    data[i] /= size_;
+  }
+}
+
+/** Iterative Cooley-Tukey transform. The inverse uses the conjugate
+ *  twiddle factors and is not normalized */
+void Fft::Transform(std::complex<double>* data, bool inverse) const {
+  for ( uint32_t i = 0; i < size_; i++ ) {
+    if ( i < reversed_[i] ) std::swap(data[i], data[reversed_[i]]);
+  }
+  for ( uint32_t half = 1; half < size_; half *= 2 ) {
+    uint32_t step = size_/(2*half);
+    for ( uint32_t start = 0; start < size_; start += 2*half ) {
+      for ( uint32_t k = 0; k < half; k++ ) {
+        std::complex<double> w = inverse ? std::conj(twiddles_[k*step]) : twiddles_[k*step];
+        std::complex<double> u = data[start + k];
+        std::complex<double> v = data[start + k + half]*w;
+        data[start + k] = u + v;
+        data[start + k + half] = u - v;
+      }
+    }
+  }
+}
@@ -0,0 +1,75 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+/* Fft.h */
+
+#ifndef SIMUSCALE_FFT_H__
+#define SIMUSCALE_FFT_H__
+
+#include <cstdlib>
+#include <complex>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * In-place radix-2 complex fast Fourier transform of a fixed size (a power
+ * of 2). Bit reversal and twiddle factors are computed once.
+ */
+class Fft {
+
+ public :
+  // ==========================================================================
+  //                               Constructors
+  // ==========================================================================
+  Fft() = default;
+  explicit Fft(uint32_t size);
+
+  // ==========================================================================
+  //                              Public Methods
+  // ==========================================================================
+
+  /** Forward transform: X_k = sum_j x_j exp(-2 i pi jk/size) */
+  void Forward(std::complex<double>* data) const;
+
+  /** Inverse transform, normalized so that Inverse(Forward(x)) = x */
+  void Inverse(std::complex<double>* data) const;
+
+  /** Smallest power of 2 not smaller than n */
+  static uint32_t Size(uint32_t n);
+
+  // ==========================================================================
+  //                                Accessors
+  // ==========================================================================
+  uint32_t size() const { return size_; }
+
+ protected :
+  void Transform(std::complex<double>* data, bool inverse) const;
+
+  uint32_t size_ = 0;
+  std::vector<uint32_t> reversed_;                 /* bit-reversed indices */
+  std::vector<std::complex<double>> twiddles_;     /* exp(-2 i pi k/size), k < size/2 */
+};
+
+#endif // SIMUSCALE_FFT_H__
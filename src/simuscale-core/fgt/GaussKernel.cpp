@@ -0,0 +1,217 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include "GaussKernel.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMUSCALE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+// =================================================================
+//                           Static functions
+// =================================================================
+namespace {
+
+/*
+ * exp(x) = 2^n exp(r), n = floor(x/log(2) + 1/2) and r = x - n log(2),
+ * log(2) split in two to keep r exact (Cephes expf)
+ */
+const float kExpMin = -87.0f;   /* 2^n stays a normal number */
+const float kLog2e = 1.44269504088896341f;
+const float kLn2Hi = 0.693359375f;
+const float kLn2Lo = -2.12194440e-4f;
+const float kP0 = 1.9875691500e-4f;
+const float kP1 = 1.3981999507e-3f;
+const float kP2 = 8.3334519073e-3f;
+const float kP3 = 4.1665795894e-2f;
+const float kP4 = 1.6666665459e-1f;
+const float kP5 = 5.0000001201e-1f;
+
+/*
+ * Reference path, the SIMD ones below must perform the same operations in
+ * the same order
+ */
+void GaussiansScalar(size_t begin, size_t n,
+                     const float* x, const float* y, const float* z,
+                     float tx, float ty, float tz,
+                     float delta, float cutoff2, float* g) {
+  const float minus_inv_delta = -1.0f / delta;
+  for (size_t j = begin; j < n; ++j) {
+    float dx = x[j] - tx;
+    float dy = y[j] - ty;
+    float dz = z[j] - tz;
+    float d2 = (dx * dx + dy * dy) + dz * dz;
+    float e = GaussKernel::Exp(d2 * minus_inv_delta);
+    g[j] = d2 < cutoff2 ? e : 0.0f;
+  }
+}
+
+#ifdef SIMUSCALE_X86_SIMD
+// No FMA: contracting the multiplications and additions would give results
+// that differ from the scalar path
+__attribute__((target("avx2")))
+__m256 ExpAvx2(__m256 x) {
+  x = _mm256_max_ps(x, _mm256_set1_ps(kExpMin));
+  __m256 n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(kLog2e)),
+                                           _mm256_set1_ps(0.5f)));
+  __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Hi)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(kLn2Lo)));
+  __m256 p = _mm256_set1_ps(kP0);
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kP1));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kP2));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kP3));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kP4));
+  p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(kP5));
+  __m256 e = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(p, _mm256_mul_ps(r, r)), r),
+                           _mm256_set1_ps(1.0f));
+  __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n),
+                                                    _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(e, _mm256_castsi256_ps(bits));
+}
+
+__attribute__((target("avx2")))
+size_t GaussiansAvx2(size_t n,
+                     const float* x, const float* y, const float* z,
+                     float tx, float ty, float tz,
+                     float delta, float cutoff2, float* g) {
+  const __m256 vtx = _mm256_set1_ps(tx);
+  const __m256 vty = _mm256_set1_ps(ty);
+  const __m256 vtz = _mm256_set1_ps(tz);
+  const __m256 minus_inv_delta = _mm256_set1_ps(-1.0f / delta);
+  const __m256 vcutoff2 = _mm256_set1_ps(cutoff2);
+  size_t j = 0;
+  for (; j + 8 <= n; j += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), vtx);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), vty);
+    __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + j), vtz);
+    __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx),
+                                            _mm256_mul_ps(dy, dy)),
+                              _mm256_mul_ps(dz, dz));
+    __m256 e = ExpAvx2(_mm256_mul_ps(d2, minus_inv_delta));
+    __m256 in_range = _mm256_cmp_ps(d2, vcutoff2, _CMP_LT_OQ);
+    _mm256_storeu_ps(g + j, _mm256_and_ps(e, in_range));
+  }
+  return j;
+}
+
+__attribute__((target("avx512f")))
+__m512 ExpAvx512(__m512 x) {
+  x = _mm512_max_ps(x, _mm512_set1_ps(kExpMin));
+  __m512 n = _mm512_roundscale_ps(_mm512_add_ps(_mm512_mul_ps(x, _mm512_set1_ps(kLog2e)),
+                                                _mm512_set1_ps(0.5f)),
+                                  _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  __m512 r = _mm512_sub_ps(x, _mm512_mul_ps(n, _mm512_set1_ps(kLn2Hi)));
+  r = _mm512_sub_ps(r, _mm512_mul_ps(n, _mm512_set1_ps(kLn2Lo)));
+  __m512 p = _mm512_set1_ps(kP0);
+  p = _mm512_add_ps(_mm512_mul_ps(p, r), _mm512_set1_ps(kP1));
+  p = _mm512_add_ps(_mm512_mul_ps(p, r), _mm512_set1_ps(kP2));
+  p = _mm512_add_ps(_mm512_mul_ps(p, r), _mm512_set1_ps(kP3));
+  p = _mm512_add_ps(_mm512_mul_ps(p, r), _mm512_set1_ps(kP4));
+  p = _mm512_add_ps(_mm512_mul_ps(p, r), _mm512_set1_ps(kP5));
+  __m512 e = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(p, _mm512_mul_ps(r, r)), r),
+                           _mm512_set1_ps(1.0f));
+  __m512i bits = _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n),
+                                                    _mm512_set1_epi32(127)), 23);
+  return _mm512_mul_ps(e, _mm512_castsi512_ps(bits));
+}
+
+__attribute__((target("avx512f")))
+size_t GaussiansAvx512(size_t n,
+                       const float* x, const float* y, const float* z,
+                       float tx, float ty, float tz,
+                       float delta, float cutoff2, float* g) {
+  const __m512 vtx = _mm512_set1_ps(tx);
+  const __m512 vty = _mm512_set1_ps(ty);
+  const __m512 vtz = _mm512_set1_ps(tz);
+  const __m512 minus_inv_delta = _mm512_set1_ps(-1.0f / delta);
+  const __m512 vcutoff2 = _mm512_set1_ps(cutoff2);
+  size_t j = 0;
+  for (; j + 16 <= n; j += 16) {
+    __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(x + j), vtx);
+    __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(y + j), vty);
+    __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(z + j), vtz);
+    __m512 d2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(dx, dx),
+                                            _mm512_mul_ps(dy, dy)),
+                              _mm512_mul_ps(dz, dz));
+    __m512 e = ExpAvx512(_mm512_mul_ps(d2, minus_inv_delta));
+    __mmask16 in_range = _mm512_cmp_ps_mask(d2, vcutoff2, _CMP_LT_OQ);
+    _mm512_storeu_ps(g + j, _mm512_maskz_mov_ps(in_range, e));
+  }
+  return j;
+}
+#endif // SIMUSCALE_X86_SIMD
+
+} // namespace
+
+
+// =================================================================
+//                            Public Methods
+// =================================================================
+void GaussKernel::Gaussians(Simd::Isa isa, size_t n,
+                            const float* x, const float* y, const float* z,
+                            float tx, float ty, float tz,
+                            float delta, float cutoff2, float* g) {
+  assert(Simd::Supports(isa));
+
+  // Vector paths process whole vectors, the remainder is done in scalar
+  size_t done = 0;
+#ifdef SIMUSCALE_X86_SIMD
+  if (isa == Simd::Isa::AVX512)
+    done = GaussiansAvx512(n, x, y, z, tx, ty, tz, delta, cutoff2, g);
+  else if (isa == Simd::Isa::AVX2)
+    done = GaussiansAvx2(n, x, y, z, tx, ty, tz, delta, cutoff2, g);
+#endif
+  GaussiansScalar(done, n, x, y, z, tx, ty, tz, delta, cutoff2, g);
+}
+
+float GaussKernel::Exp(float x) {
+  x = std::max(x, kExpMin);
+  float n = std::floor(x * kLog2e + 0.5f);
+  float r = x - n * kLn2Hi;
+  r = r - n * kLn2Lo;
+  float p = kP0;
+  p = p * r + kP1;
+  p = p * r + kP2;
+  p = p * r + kP3;
+  p = p * r + kP4;
+  p = p * r + kP5;
+  float e = (p * (r * r) + r) + 1.0f;
+  int32_t bits = ((int32_t) n + 127) << 23;
+  float scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return e * scale;
+}
@@ -0,0 +1,82 @@
+// ****************************************************************************
+//
+//              SiMuScale - Multi-scale simulation framework
+//
+// ****************************************************************************
+//
+// Copyright: See the AUTHORS file provided with the package
+// E-mail: simuscale-contact@lists.gforge.inria.fr
+// Original Authors : Samuel Bernard, Carole Knibbe, David Parsons
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// ****************************************************************************
+
+#ifndef SIMUSCALE_GAUSSKERNEL_H__
+#define SIMUSCALE_GAUSSKERNEL_H__
+
+
+// =================================================================
+//                              Includes
+// =================================================================
+#include <cstddef>
+
+#include "Simd.h"
+
+
+// =================================================================
+//                          Class declarations
+// =================================================================
+
+
+
+/*!
+  \brief Gaussians of a target and packed arrays of sources, with a cutoff.
+
+  For each source j, given its coordinates (x_j, y_j, z_j) and the target
+  (tx, ty, tz) at square distance d2_j,
+
+    g_j = exp(-d2_j / delta) if d2_j < cutoff2, 0 otherwise.
+
+  The exponential is a polynomial of degree 7 after reduction by powers of
+  2 (relative error about 1e-7), valid down to exp(-87).
+
+  The AVX2 and AVX-512 paths perform the very same IEEE operations as the
+  scalar one, lane by lane, so that the result does not depend on the path
+  used. The fastest path supported by the CPU is used by default (see Simd).
+*/
+class GaussKernel {
+ public :
+  // =================================================================
+  //                            Public Methods
+  // =================================================================
+  /** Compute the Gaussians of n sources with the fastest available path */
+  static void Gaussians(size_t n,
+                        const float* x, const float* y, const float* z,
+                        float tx, float ty, float tz,
+                        float delta, float cutoff2, float* g) {
+    Gaussians(Simd::isa(), n, x, y, z, tx, ty, tz, delta, cutoff2, g);
+  }
+  /** Compute the Gaussians of n sources with the given path, which must be
+   * supported (see Simd::Supports) */
+  static void Gaussians(Simd::Isa isa, size_t n,
+                        const float* x, const float* y, const float* z,
+                        float tx, float ty, float tz,
+                        float delta, float cutoff2, float* g);
+
+  /** Exponential of the kernel, x <= 0 */
+  static float Exp(float x);
+};
+
+#endif // SIMUSCALE_GAUSSKERNEL_H__
@@ -50,6 +50,24 @@ H_Real Hermite::Function(H_Real t, size_t n) {
   return instance_.Polynomial(t,n)*exp(-t*t); 
 }
 
+/** Hermite functions h_0(t) to h_{n-1}(t)
+ *  h_{k+1}(t) = 2t h_k(t) - 2k h_{k-1}(t), h_0(t) = exp(-t^2)
+ */
+void Hermite::Functions(H_Real t, size_t n, H_Real* h) {
+  if ( n > max_order_ + 1 ) {
+    fprintf(stderr,"n too big\n");
+    exit(1);
+  }
+  if ( n == 0 ) return;
+  h[0] = exp(-t*t);
+  if ( n == 1 ) return;
+  h[1] = 2*t*h[0];
+  for ( size_t k = 1; k + 1 < n; k++ )
+  {
+    h[k + 1] = 2*t*h[k] - 2*k*h[k - 1];
+  }
+}
+
 /** Hermite 1D polynomial */
 H_Real Hermite::Polynomial(H_Real t, size_t n) {
 
@@ -64,6 +64,9 @@ class Hermite {
   /** Hermite function */
   static H_Real Function(H_Real t, size_t n);
 
+  /** Hermite functions of orders 0 to n - 1, by recurrence, stored in h */
+  static void Functions(H_Real t, size_t n, H_Real* h);
+
   // ==========================================================================
   //                                Accessors
   // ==========================================================================
@@ -56,6 +56,9 @@ class Immobile : public MoveBehaviour {
   //                              Public Methods
   // ==========================================================================
   void Move(Cell*, const double&) const override {return;}
+  Coordinates<double> Displacement(Cell*, const double&) const override {
+    return Coordinates<double>(0.0, 0.0, 0.0);
+  }
   MoveBehaviour::Type type() const override {return IMMOBILE;}
 
  protected:
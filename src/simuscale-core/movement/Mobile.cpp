@@ -52,7 +52,7 @@ Mobile::~Mobile() {
 // ============================================================================
 //                                   Methods
 // ============================================================================
-void Mobile::Move(Cell* cell, const double& dt) const {
+Coordinates<double> Mobile::Displacement(Cell* cell, const double& dt) const {
   // Compute the displacement in space.
   // NB: gravity is applied on z
   double gravity = 0.2;
@@ -60,6 +60,5 @@ void Mobile::Move(Cell* cell, const double& dt) const {
                            dt * cell->mechanical_force_.y,
                            dt * (cell->mechanical_force_.z)};// - gravity)};
 
-  // Apply displacement
-  cell->Move(dpos);
+  return dpos;
 }
@@ -56,7 +56,7 @@ class Mobile : public MoveBehaviour {
   // ==========================================================================
   //                              Public Methods
   // ==========================================================================
-  void Move(Cell* cell, const double& dt) const override;
+  Coordinates<double> Displacement(Cell* cell, const double& dt) const override;
   MoveBehaviour::Type type() const override {return MOBILE;}
 
  protected:
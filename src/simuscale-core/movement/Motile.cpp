@@ -52,7 +52,7 @@ Motile::~Motile() {
 // ============================================================================
 //                                   Methods
 // ============================================================================
-void Motile::Move(Cell* cell, const double& dt) const {
+Coordinates<double> Motile::Displacement(Cell* cell, const double& dt) const {
   // Compute the displacement in space.
   Coordinates<double> dpos{dt * cell->mechanical_force_.x,
                            dt * cell->mechanical_force_.y,
@@ -60,6 +60,5 @@ void Motile::Move(Cell* cell, const double& dt) const {
 
   dpos += cell->motility(dt);
 
-  // Apply displacement
-  cell->Move(dpos);
+  return dpos;
 }
@@ -32,6 +32,7 @@
 #include "Immobile.h"
 #include "Mobile.h"
 #include "Motile.h"
+#include "Cell.h"
 
 // ============================================================================
 //                                   Methods
@@ -50,6 +51,10 @@ MoveBehaviour& MoveBehaviour::instance(Type type) {
   };
 }
 
+void MoveBehaviour::Move(Cell* cell, const double& dt) const {
+  cell->Move(Displacement(cell, dt));
+}
+
 void MoveBehaviour::Save(gzFile backup_file) const {
   int8_t type = static_cast<int8_t>(this->type());
   gzwrite(backup_file, &type, sizeof(type));
@@ -31,6 +31,8 @@
 // ============================================================================
 #include <zlib.h>
 
+#include "Coordinates.h"
+
 // ============================================================================
 //                         Class declarations, Using etc
 // ============================================================================
@@ -69,7 +71,10 @@ class MoveBehaviour {
   //                              Public Methods
   // ==========================================================================
   static MoveBehaviour& instance(Type type);
-  virtual void Move(Cell* cell, const double& dt) const = 0;
+  /** Apply the displacement of cell over dt */
+  virtual void Move(Cell* cell, const double& dt) const;
+  /** Displacement of cell over dt (not applied) */
+  virtual Coordinates<double> Displacement(Cell* cell, const double& dt) const = 0;
   virtual Type type() const = 0;
   virtual void Save(gzFile backup_file) const;
   static MoveBehaviour* Load(gzFile backup_file);
@@ -37,6 +37,7 @@
 // =================================================================
 //                            Project Files
 // =================================================================
+#include "OdeSolver.h"
 
 // =================================================================
 //                          Class declarations
@@ -73,6 +74,9 @@ class CellParams {
   // =================================================================
   double radii_ratio() const { return radii_ratio_; };
   double volume_max_min_ratio() const { return volume_max_min_ratio_; };
+  uint32_t ode_system_size() const { return ode_system_size_; };
+  uint32_t ode_nb_params() const { return ode_nb_params_; };
+  const OdeSolver::Settings& ode_settings() const { return ode_settings_; };
 
  protected :
   // =================================================================
@@ -88,6 +92,14 @@ class CellParams {
   /** Ratio between the maximal and the minimal volume */
   double volume_max_min_ratio_ = 2.2;
 
+  /** Size and number of parameters of the ODE system of each cell, for the
+   * formalisms that have one (see Cell::RegisterOde) */
+  uint32_t ode_system_size_ = 0;
+  uint32_t ode_nb_params_ = 0;
+
+  /** How the ODE systems are integrated */
+  OdeSolver::Settings ode_settings_;
+
   // =================================================================
   //                           Private Methods
   // =================================================================
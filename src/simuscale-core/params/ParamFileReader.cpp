@@ -97,6 +97,52 @@ void ParamFileReader::interpret_line(f_line* line) {
   else if (strcmp(line->words[0], "BACKUP_DT") == 0) {
     simParams.backup_dt_ = atof(line->words[1]);
   }
+  else if (strcmp(line->words[0], "THREADS") == 0) {
+    if(strcmp(line->words[1], "AUTO") == 0) {
+      simParams.threads_ = 0;
+    }
+    else {
+      simParams.threads_ = atol(line->words[1]);
+      if (simParams.threads_ < 1) {
+        printf("ERROR in param file \"%s\" on line %" PRId32
+                   ": THREADS must be a positive integer or AUTO.\n",
+               _param_file_name.c_str(), _cur_line);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  else if (strcmp(line->words[0], "NEIGHBOUR_SKIN") == 0) {
+    simParams.neighbour_skin_ = atof(line->words[1]);
+    if (simParams.neighbour_skin_ < 0.0) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": NEIGHBOUR_SKIN must be non-negative.\n",
+             _param_file_name.c_str(), _cur_line);
+      exit(EXIT_FAILURE);
+    }
+  }
+  else if (strcmp(line->words[0], "VOXEL_SIZE") == 0) {
+    if(strcmp(line->words[1], "AUTO") == 0) {
+      simParams.voxel_size_ = 0.0;
+    }
+    else {
+      simParams.voxel_size_ = atof(line->words[1]);
+      if (simParams.voxel_size_ <= 0.0) {
+        printf("ERROR in param file \"%s\" on line %" PRId32
+                   ": VOXEL_SIZE must be positive or AUTO.\n",
+               _param_file_name.c_str(), _cur_line);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  else if (strcmp(line->words[0], "FGT_COSTS") == 0) {
+    if (line->nb_words != 2) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": FGT_COSTS must be DEFAULT, CALIBRATE or a file name.\n",
+             _param_file_name.c_str(), _cur_line);
+      exit(EXIT_FAILURE);
+    }
+    simParams.fgt_costs_ = line->words[1];
+  }
   else if (strcmp(line->words[0], "NICHE") == 0) {
     if (line->nb_words != 3) {
       printf("ERROR in param file \"%s\" on line %" PRId32
@@ -184,6 +230,7 @@ void ParamFileReader::interpret_line(f_line* line) {
         if ( strcmp(line->words[2], "DIFFUSIVE") == 0) {
           simParams.using_diffusive_signals_.push_back (simParams.StrToInterCellSignal(line->words[1]));
           simParams.diffusive_delta_.push_back (atof(line->words[3]));
+          simParams.diffusive_solver_.push_back (DiffusionSolver::UNIFORM);
         }
       }
       if (line->nb_words >= 6) {
@@ -191,6 +238,12 @@ void ParamFileReader::interpret_line(f_line* line) {
           simParams.diffusive_epsilon_.push_back (atof(line->words[5]));
         }
       }
+      if (line->nb_words >= 8) {
+        if ( strcmp(line->words[2], "DIFFUSIVE") == 0 &&
+             strcmp(line->words[6], "SOLVER") == 0) {
+          simParams.diffusive_solver_.back() = simParams.StrToDiffusionSolver(line->words[7]);
+        }
+      }
     }
     catch (const string& error) {
       printf("ERROR in param file \"%s\" on line %" PRId32
@@ -215,15 +268,6 @@ void ParamFileReader::interpret_line(f_line* line) {
       exit(EXIT_FAILURE);
 
     }
-
-    if ( simParams.worldsize_params_.size_.x > 100 ||
-         simParams.worldsize_params_.size_.y > 100 ||
-         simParams.worldsize_params_.size_.z > 100 ) {
-      printf("ERROR in param file \"%s\" on line %" PRId32
-                 ": max world size is 100.\n",
-             _param_file_name.c_str(), _cur_line);
-      exit(EXIT_FAILURE);
-    }
   }
   
   // WORLD MARGIN
@@ -299,16 +343,61 @@ void ParamFileReader::interpret_line(f_line* line) {
 
   // CELL_ODE PARAMETERS
   else if (strcmp(line->words[0], "ODESYSTEMSIZE") == 0) {
-    printf("ERROR in param file \"%s\" on line %d:"
-           " key word no longer supported \"%s\"\n",
-           _param_file_name.c_str(), _cur_line, line->words[0]);
-    exit(EXIT_FAILURE);
+    if (atol(line->words[1]) < 1) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": ODESYSTEMSIZE must be a positive integer.\n",
+             _param_file_name.c_str(), _cur_line);
+      exit(EXIT_FAILURE);
+    }
+    simParams.cell_params_.ode_system_size_ = atol(line->words[1]);
   }
   else if (strcmp(line->words[0], "ODENBPARAMS") == 0) {
-    printf("ERROR in param file \"%s\" on line %d:"
-           " key word no longer supported \"%s\"\n",
-           _param_file_name.c_str(), _cur_line, line->words[0]);
-    exit(EXIT_FAILURE);
+    if (atol(line->words[1]) < 0) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": ODENBPARAMS must be a non-negative integer.\n",
+             _param_file_name.c_str(), _cur_line);
+      exit(EXIT_FAILURE);
+    }
+    simParams.cell_params_.ode_nb_params_ = atol(line->words[1]);
+  }
+  else if (strcmp(line->words[0], "ODESOLVER") == 0) {
+    if (line->nb_words > 3) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": incorrect number of parameters for keyword \"%s\".\n",
+             _param_file_name.c_str(), _cur_line, line->words[0]);
+      exit(EXIT_FAILURE);
+    }
+    OdeSolver::Settings& settings = simParams.cell_params_.ode_settings_;
+    try {
+      settings.method = OdeSolver::StrToMethod(line->words[1]);
+    }
+    catch (const string& error) {
+      printf("ERROR in param file \"%s\" on line %" PRId32
+                 ": %s.\n",
+             _param_file_name.c_str(), _cur_line, error.c_str());
+      exit(EXIT_FAILURE);
+    }
+    // RK4 takes a number of steps per time-step, the others a tolerance
+    if (line->nb_words == 3) {
+      if (settings.method == OdeSolver::Method::RK4) {
+        if (atol(line->words[2]) < 1) {
+          printf("ERROR in param file \"%s\" on line %" PRId32
+                     ": the number of steps of RK4 must be positive.\n",
+                 _param_file_name.c_str(), _cur_line);
+          exit(EXIT_FAILURE);
+        }
+        settings.nb_steps = atol(line->words[2]);
+      }
+      else {
+        if (atof(line->words[2]) <= 0.0) {
+          printf("ERROR in param file \"%s\" on line %" PRId32
+                     ": the tolerance of %s must be positive.\n",
+                 _param_file_name.c_str(), _cur_line, line->words[1]);
+          exit(EXIT_FAILURE);
+        }
+        settings.tolerance = atof(line->words[2]);
+      }
+    }
   }
 
   // ERRONEOUS KEYWORD
@@ -114,6 +114,21 @@ InterCellSignal SimulationParams::StrToInterCellSignal(const std::string signal_
 
 }
 
+DiffusionSolver SimulationParams::StrToDiffusionSolver(const std::string solver_str) {
+  if (solver_str == "UNIFORM") {
+    return DiffusionSolver::UNIFORM;
+  }
+  else if (solver_str == "ADAPTIVE") {
+    return DiffusionSolver::ADAPTIVE;
+  }
+  else if (solver_str == "MESH") {
+    return DiffusionSolver::MESH;
+  }
+  else {
+    throw string("unknown diffusion solver " + solver_str + " (use UNIFORM/ADAPTIVE/MESH)");
+  }
+}
+
 
 /**
  * Map cell formalism param file keywords to classIds
@@ -47,6 +47,7 @@
 #include "InterCellSignal.h"
 #include "NicheParams.h"
 #include "movement/MoveBehaviour.h"
+#include "fgt/DiffusionSolver.h"
 
 /*!
   \brief Parameters used to create the simulation
@@ -76,6 +77,10 @@ class SimulationParams {
   int32_t maxpop() const { return maxpop_; };
   double dt() const { return dt_; };
   double backup_dt() const { return backup_dt_; };
+  int32_t threads() const { return threads_; };
+  double neighbour_skin() const { return neighbour_skin_; };
+  double voxel_size() const { return voxel_size_; };
+  const std::string& fgt_costs() const { return fgt_costs_; };
   // TODO(dpa) constness
   const std::list<PopulationParams>& pop_params() const { return pop_params_; };
   const NicheParams& niche_params() const { return niche_params_; };
@@ -91,6 +96,7 @@ class SimulationParams {
   const std::list<InterCellSignal>& using_diffusive_signals() const { return using_diffusive_signals_; };
   const std::vector<float>& diffusive_delta() const { return diffusive_delta_; }
   const std::vector<float>& diffusive_epsilon() const { return diffusive_epsilon_; }
+  const std::vector<DiffusionSolver>& diffusive_solver() const { return diffusive_solver_; }
   const std::vector<std::string>& celltype_names() const { return celltype_names_; };
 
   // ==========================================================================
@@ -112,6 +118,7 @@ class SimulationParams {
   CellType StrToCellType(const std::string cell_type_str);
   MoveBehaviour::Type StrToMBType(const std::string mb_str);
   InterCellSignal StrToInterCellSignal(const std::string signal_str);
+  DiffusionSolver StrToDiffusionSolver(const std::string solver_str);
 
   // ==========================================================================
   //                                 Attributes
@@ -125,6 +132,17 @@ class SimulationParams {
   /** default macroscopic time step */
   double dt_ = 0.2; // We aim at a code working with DT=0.5 or DT=1
   double backup_dt_ = 10.0; // Frequency of backups
+  /** Number of threads used by the parallel phases (0: use all available) */
+  int32_t threads_ = 1;
+  /** Skin of the neighbour candidate lists (0: search neighbours at each
+   * time-step) */
+  double neighbour_skin_ = 0.0;
+  /** Size of the voxels of the spatial grid (0: twice the largest radius a
+   * cell can reach) */
+  double voxel_size_ = 0.0;
+  /** Cost model of the fast Gauss transform kernels: DEFAULT, CALIBRATE
+   * (time them at start-up) or the file of a previous calibration */
+  std::string fgt_costs_ = "DEFAULT";
   std::list<PopulationParams> pop_params_;
   NicheParams niche_params_;
   CellParams cell_params_;
@@ -147,6 +165,7 @@ class SimulationParams {
   std::list<InterCellSignal> using_diffusive_signals_;
   std::vector<float> diffusive_delta_;
   std::vector<float> diffusive_epsilon_;
+  std::vector<DiffusionSolver> diffusive_solver_;
 
  public:
   /** Map cell formalism param file keywords to classIds */
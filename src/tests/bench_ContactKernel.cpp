@@ -0,0 +1,115 @@
+/*
+ * Microbenchmark of the contact force kernel on a dense spheroid
+ *
+ * Cells are packed on a jittered cubic lattice inside a sphere, at about the
+ * contact distance, and every pair closer than the sum of the external radii
+ * is listed. The pow-based per-pair computation (as in Cell::AddMechForce)
+ * is compared to each path of ContactKernel.
+ *
+ * Usage: bench_ContactKernel [NB_CELLS [NB_REPEATS]]
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "ContactKernel.h"
+
+static constexpr double kLJFactor = 1.122462048309373;
+static constexpr double kEpsilon = 0.002;
+static constexpr double kMaxForce = 0.5;
+
+struct Pairs {
+  std::vector<double> dx, dy, dz, r, sigma;
+};
+
+static Pairs DenseSpheroid(int nb_cells) {
+  std::mt19937 gen(155);
+  std::uniform_real_distribution<double> jitter(-0.05, 0.05);
+  std::uniform_real_distribution<double> radius(0.62, 0.8);
+
+  // Cells on a lattice of spacing close to a diameter, within a sphere
+  const double spacing = 1.3;
+  const int side = static_cast<int>(ceil(cbrt(nb_cells * 6 / M_PI))) + 1;
+  const double max_dist = side * spacing / 2;
+  std::vector<double> x, y, z, ext;
+  for (int i = 0; i < side and static_cast<int>(x.size()) < nb_cells; i++)
+    for (int j = 0; j < side and static_cast<int>(x.size()) < nb_cells; j++)
+      for (int k = 0; k < side and static_cast<int>(x.size()) < nb_cells; k++) {
+        double px = (i - side / 2.) * spacing, py = (j - side / 2.) * spacing,
+               pz = (k - side / 2.) * spacing;
+        if (sqrt(px * px + py * py + pz * pz) > max_dist) continue;
+        x.push_back(px + jitter(gen));
+        y.push_back(py + jitter(gen));
+        z.push_back(pz + jitter(gen));
+        ext.push_back(radius(gen));
+      }
+
+  Pairs pairs;
+  for (size_t i = 0; i < x.size(); i++)
+    for (size_t j = i + 1; j < x.size(); j++) {
+      double dx = x[j] - x[i], dy = y[j] - y[i], dz = z[j] - z[i];
+      double r = sqrt(dx * dx + dy * dy + dz * dz);
+      if (r >= ext[i] + ext[j]) continue;
+      pairs.dx.push_back(dx);
+      pairs.dy.push_back(dy);
+      pairs.dz.push_back(dz);
+      pairs.r.push_back(r);
+      pairs.sigma.push_back(0.9 * (ext[i] + ext[j]) / kLJFactor);
+    }
+  return pairs;
+}
+
+static void PowForces(const Pairs& pairs, std::vector<double>& fx,
+                      std::vector<double>& fy, std::vector<double>& fz) {
+  for (size_t k = 0; k < pairs.r.size(); k++) {
+    double distance = pairs.r[k], sigma = pairs.sigma[k];
+    double force = -24.0 * kEpsilon *
+                   (2.0 * pow(sigma, 12) / pow(distance, 13) -
+                    pow(sigma, 6) / pow(distance, 7));
+    if (fabs(force) > kMaxForce) {
+      force = (force > 0) ? kMaxForce : -kMaxForce;
+    }
+    fx[k] = force * pairs.dx[k] / distance;
+    fy[k] = force * pairs.dy[k] / distance;
+    fz[k] = force * pairs.dz[k] / distance;
+  }
+}
+
+template <typename F>
+static double Time(int nb_repeats, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int rep = 0; rep < nb_repeats; rep++) f();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / nb_repeats;
+}
+
+int main(int argc, char* argv[]) {
+  int nb_cells = (argc > 1) ? atoi(argv[1]) : 4000;
+  int nb_repeats = (argc > 2) ? atoi(argv[2]) : 200;
+
+  Pairs pairs = DenseSpheroid(nb_cells);
+  const size_t n = pairs.r.size();
+  std::vector<double> fx(n), fy(n), fz(n);
+  printf("%d cells, %zu pairs, %d repeats\n", nb_cells, n, nb_repeats);
+
+  double reference = Time(nb_repeats, [&] { PowForces(pairs, fx, fy, fz); });
+  printf("%-8s %10.3f ns/pair\n", "pow", 1e9 * reference / n);
+
+  for (auto isa : Simd::supported()) {
+    double t = Time(nb_repeats, [&] {
+      ContactKernel::ComputeForces(isa, n, pairs.dx.data(), pairs.dy.data(),
+                                   pairs.dz.data(), pairs.r.data(),
+                                   pairs.sigma.data(), kEpsilon, kMaxForce,
+                                   fx.data(), fy.data(), fz.data());
+    });
+    printf("%-8s %10.3f ns/pair (x%.1f)\n", Simd::name(isa),
+           1e9 * t / n, reference / t);
+  }
+
+  return EXIT_SUCCESS;
+}
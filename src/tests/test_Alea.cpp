@@ -0,0 +1,113 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include <zlib.h>
+
+#include "Alea.h"
+
+
+/*
+ * Draw n uniform numbers from the stream (stream_id, timestep, phase)
+ */
+static std::vector<double> draw(uint32_t stream_id, uint32_t timestep,
+                                uint32_t phase, int n) {
+  Alea::ScopedStream stream(stream_id, timestep, phase);
+  std::vector<double> values;
+  for (int i = 0; i < n; i++) values.push_back(Alea::random());
+  return values;
+}
+
+
+class TestAleaStreams : public testing::Test {
+protected:
+  virtual void SetUp() {
+    Alea::seed(155);
+  }
+};
+
+TEST_F(TestAleaStreams, SameStreamSameDraws)
+{
+  EXPECT_EQ(draw(12, 3, 0, 9), draw(12, 3, 0, 9));
+}
+
+TEST_F(TestAleaStreams, DrawsDoNotDependOnOtherStreams)
+{
+  std::vector<double> first = draw(12, 3, 0, 9);
+  draw(13, 3, 0, 5);
+  Alea::random();
+  EXPECT_EQ(first, draw(12, 3, 0, 9));
+}
+
+TEST_F(TestAleaStreams, DistinctStreamsDiffer)
+{
+  std::vector<double> ref = draw(12, 3, 0, 4);
+  EXPECT_NE(ref, draw(13, 3, 0, 4));
+  EXPECT_NE(ref, draw(12, 4, 0, 4));
+  EXPECT_NE(ref, draw(12, 3, 1, 4));
+  Alea::seed(156);
+  EXPECT_NE(ref, draw(12, 3, 0, 4));
+}
+
+TEST_F(TestAleaStreams, ScopedStreamsNest)
+{
+  double global_first = Alea::random();
+  Alea::seed(155);
+  {
+    Alea::ScopedStream outer(1, 0, 0);
+    double outer_first = Alea::random();
+    {
+      Alea::ScopedStream inner(2, 0, 0);
+      Alea::random();
+    }
+    EXPECT_NE(outer_first, Alea::random());
+  }
+  EXPECT_EQ(global_first, Alea::random());
+}
+
+TEST_F(TestAleaStreams, GlobalStreamIsRestored)
+{
+  Alea::random();
+  Alea::random();
+  Alea::random();
+
+  gzFile backup_file = gzopen("test_Alea_backup.gz", "w");
+  Alea::instance().Save(backup_file);
+  gzclose(backup_file);
+
+  std::vector<double> expected;
+  for (int i = 0; i < 5; i++) expected.push_back(Alea::random());
+
+  Alea::seed(7);
+  backup_file = gzopen("test_Alea_backup.gz", "r");
+  Alea::instance().Load(backup_file);
+  gzclose(backup_file);
+
+  std::vector<double> actual;
+  for (int i = 0; i < 5; i++) actual.push_back(Alea::random());
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(TestAleaDistributions, DiscreteDistributionFollowsWeights)
+{
+  Alea::seed(155);
+  const double weights[3] = {1.0, 0.0, 3.0};
+  int counts[3] = {0, 0, 0};
+  for (int i = 0; i < 4000; i++) counts[Alea::discrete_distribution(3, weights)]++;
+  EXPECT_EQ(0, counts[1]);
+  EXPECT_NEAR(1000, counts[0], 100);
+  EXPECT_NEAR(3000, counts[2], 100);
+}
+
+TEST(TestAleaDistributions, UniformInRange)
+{
+  Alea::seed(155);
+  for (int i = 0; i < 1000; i++) {
+    double u = Alea::random();
+    EXPECT_LE(0.0, u);
+    EXPECT_GT(1.0, u);
+    int32_t k = Alea::random(10);
+    EXPECT_LE(0, k);
+    EXPECT_GT(10, k);
+  }
+}
@@ -1,7 +1,14 @@
 #include "gtest/gtest.h"
 
+#include <sys/stat.h>
+
+#include <fstream>
+#include <vector>
+
 #include "Cell.h"
 #include "Alea.h"
+#include "Simulation.h"
+#include "params/ParamFileReader.h"
 #include "movement/Mobile.h"
 #include "movement/Immobile.h"
 
@@ -232,3 +239,140 @@ TEST_F(TestCellMechInteraction, CellsMustGetCloser) {
 
   ASSERT_GT(initial_distance, first_cell->Distance(second_cell));
 }
+
+void BatchUpdateProxies(Cell* const*, size_t, const double&) {}
+
+TEST(TestCellRegistration, BatchUpdateIsRegisteredWithTheFormalism) {
+  const CellFormalism formalism = 0x1badcafe;
+  Cell::RegisterClass(formalism, "CELL_PROXY",
+      [](CellType type, const MoveBehaviour& move_behaviour,
+         const Coordinates<double>& pos, double initial_volume,
+         double volume_min, double doubling_time) {
+        return static_cast<Cell*>(new CellProxy(type, move_behaviour, pos,
+                                                initial_volume, volume_min,
+                                                doubling_time));
+      },
+      [](gzFile) { return static_cast<Cell*>(nullptr); },
+      &BatchUpdateProxies);
+
+  EXPECT_EQ(&BatchUpdateProxies, Cell::batch_update(formalism));
+  EXPECT_TRUE(Cell::batch_update(formalism + 1) == nullptr);
+
+  Cell* cell = Cell::MakeCell(formalism, Mobile::instance(), STEM,
+                              Coordinates<double>(3.0, 3.0, 3.0),
+                              0.5, 0.25, 0.2);
+  EXPECT_EQ(formalism, cell->formalism());
+  delete cell;
+}
+
+
+/*
+ * Proxy whose internal state is updated by a batch update, recording what the
+ * simulation loop does with it
+ */
+class BatchedCellProxy : public Cell {
+public:
+  BatchedCellProxy(CellType cellType,
+                   const MoveBehaviour& move_behaviour,
+                   const Coordinates<double>& pos,
+                   double initial_volume,
+                   double volume_min,
+                   double doubling_time) :
+          Cell(cellType, move_behaviour,
+               pos, CellSize(initial_volume, volume_min),
+               doubling_time) {}
+
+  Cell* Divide() { return nullptr; }
+  bool isCycling() const { return false; }
+  bool isDividing() const { return false; }
+  bool isDying() const { return false; }
+  double get_output(InterCellSignal) const { return 0.0; }
+  void UpdateCyclingStatus() {}
+  bool StopCycling() { return true; }
+  bool StartCycling() { return true; }
+
+  void InternalUpdate(const double&) {
+    moves_before_update.push_back(nb_moves);
+    timesteps.push_back(Simulation::timestep());
+    draws.push_back(Alea::random());
+  }
+
+  static void BatchUpdate(Cell* const* cells, size_t nb_cells,
+                          const double& dt) {
+    batch_sizes.push_back(nb_cells);
+    InternalUpdates(cells, nb_cells, dt);
+  }
+
+  /** Stays where it is, counts the displacements computed */
+  class CountingMoves : public MoveBehaviour {
+   public:
+    Coordinates<double> Displacement(Cell* cell, const double&) const {
+      static_cast<BatchedCellProxy*>(cell)->nb_moves++;
+      return Coordinates<double>(0.0, 0.0, 0.0);
+    }
+    Type type() const { return MOBILE; }
+  };
+  static const CountingMoves counting_moves;
+
+  int nb_moves = 0;
+  std::vector<int> moves_before_update;
+  std::vector<int32_t> timesteps;
+  std::vector<double> draws;
+  static std::vector<size_t> batch_sizes;
+};
+
+const BatchedCellProxy::CountingMoves BatchedCellProxy::counting_moves;
+std::vector<size_t> BatchedCellProxy::batch_sizes;
+
+TEST(TestCellRegistration, BatchUpdateIsAppliedOncePerTimeStep) {
+  const CellFormalism formalism = 0x0badbeef;
+  Cell::RegisterClass(formalism, "BATCHED_CELL_PROXY",
+      [](CellType type, const MoveBehaviour&,
+         const Coordinates<double>& pos, double initial_volume,
+         double volume_min, double doubling_time) {
+        return static_cast<Cell*>(new BatchedCellProxy(
+            type, BatchedCellProxy::counting_moves, pos, initial_volume,
+            volume_min, doubling_time));
+      },
+      [](gzFile) { return static_cast<Cell*>(nullptr); },
+      &BatchedCellProxy::BatchUpdate);
+
+  const int nb_cells = 20, nb_steps = 10;
+  mkdir("batch_update", 0755);
+  {
+    std::ofstream param_file("batch_update/param.in");
+    param_file << "PRNG_SEED 1421746927\n"
+               << "MAXTIME " << nb_steps * 0.05 << "\n"
+               << "DT 0.05\n"
+               << "BACKUP_DT 1000\n"
+               << "THREADS 4\n"
+               << "ADD_POPULATION " << nb_cells
+               << " STEM BATCHED_CELL_PROXY MOBILE 10 1.0\n";
+  }
+  ParamFileReader reader("batch_update/param.in");
+  reader.load();
+  Simulation::Setup(reader.get_simParams(), "batch_update");
+  Simulation::Run();
+
+  // A single batch update per time-step, with all the cells of the formalism
+  ASSERT_EQ(static_cast<size_t>(nb_steps), BatchedCellProxy::batch_sizes.size());
+  for (size_t batch_size : BatchedCellProxy::batch_sizes)
+    EXPECT_EQ(static_cast<size_t>(nb_cells), batch_size);
+
+  ASSERT_EQ(nb_cells, Simulation::pop().Size());
+  for (Cell* cell : Simulation::pop().cells()) {
+    BatchedCellProxy* proxy = static_cast<BatchedCellProxy*>(cell);
+    // The displacement is computed before the internal update, at each step
+    ASSERT_EQ(static_cast<size_t>(nb_steps), proxy->moves_before_update.size());
+    for (int step = 0; step < nb_steps; step++)
+      EXPECT_EQ(step + 1, proxy->moves_before_update[step]);
+
+    // The updates, made on several threads, draw the same numbers as when
+    // the cells are updated one after the other
+    for (int step = 0; step < nb_steps; step++) {
+      Alea::ScopedStream stream(cell->id(), proxy->timesteps[step],
+                                Simulation::kInternalStream);
+      EXPECT_EQ(Alea::random(), proxy->draws[step]);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "ContactKernel.h"
+
+
+class TestContactKernel : public testing::Test {
+protected:
+  virtual void SetUp() {
+    // Pairs at distances spanning strong repulsion to weak attraction, in
+    // various directions. 37 is not a multiple of the vector widths
+    for (int k = 0; k < 37; k++) {
+      double r = 0.6 + 0.03 * k;
+      double theta = 0.7 * k, phi = 0.3 * k;
+      dx.push_back(r * sin(theta) * cos(phi));
+      dy.push_back(r * sin(theta) * sin(phi));
+      dz.push_back(r * cos(theta));
+      this->r.push_back(r);
+      sigma.push_back((0.9 + 0.01 * (k % 5)) / 1.122462048309373);
+    }
+  }
+
+  void Compute(Simd::Isa isa, std::vector<double>& fx,
+               std::vector<double>& fy, std::vector<double>& fz) {
+    fx.assign(r.size(), 0.0);
+    fy.assign(r.size(), 0.0);
+    fz.assign(r.size(), 0.0);
+    ContactKernel::ComputeForces(isa, r.size(), dx.data(), dy.data(),
+                                 dz.data(), r.data(), sigma.data(),
+                                 epsilon, max_force,
+                                 fx.data(), fy.data(), fz.data());
+  }
+
+  std::vector<double> dx, dy, dz, r, sigma;
+  double epsilon = 0.002;
+  double max_force = 0.05;
+};
+
+TEST_F(TestContactKernel, MatchesLennardJones)
+{
+  std::vector<double> fx, fy, fz;
+  Compute(Simd::Isa::SCALAR, fx, fy, fz);
+  for (size_t k = 0; k < r.size(); k++) {
+    double force = -24.0 * epsilon *
+                   (2.0 * pow(sigma[k], 12) / pow(r[k], 13) -
+                    pow(sigma[k], 6) / pow(r[k], 7));
+    if (fabs(force) > max_force)
+      force = (force > 0) ? max_force : -max_force;
+    EXPECT_NEAR(force * dx[k] / r[k], fx[k], 1e-15);
+    EXPECT_NEAR(force * dy[k] / r[k], fy[k], 1e-15);
+    EXPECT_NEAR(force * dz[k] / r[k], fz[k], 1e-15);
+  }
+}
+
+TEST_F(TestContactKernel, ForcesAreClipped)
+{
+  std::vector<double> fx, fy, fz;
+  Compute(Simd::Isa::SCALAR, fx, fy, fz);
+  // The closest pair is strongly repulsed
+  EXPECT_DOUBLE_EQ(max_force * max_force,
+                   fx[0] * fx[0] + fy[0] * fy[0] + fz[0] * fz[0]);
+}
+
+TEST_F(TestContactKernel, VectorPathsMatchScalarPath)
+{
+  std::vector<double> fx, fy, fz;
+  Compute(Simd::Isa::SCALAR, fx, fy, fz);
+  for (auto isa : {Simd::Isa::AVX2, Simd::Isa::AVX512}) {
+    if (not Simd::Supports(isa)) continue;
+    std::vector<double> vx, vy, vz;
+    Compute(isa, vx, vy, vz);
+    EXPECT_EQ(fx, vx) << Simd::name(isa);
+    EXPECT_EQ(fy, vy) << Simd::name(isa);
+    EXPECT_EQ(fz, vz) << Simd::name(isa);
+  }
+}
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "fgt/FastGaussTransform3D.h"
+
+
+using real_type = FastGaussTransform3D::real_type_;
+using point_type = FastGaussTransform3D::point_type_;
+
+
+class TestFastGaussTransform : public testing::Test {
+protected:
+  virtual void SetUp() {
+    // A loose cloud and a dense cluster of points, so that both direct and
+    // expanded interactions are used
+    for (int k = 0; k < 3000; k++) {
+      real_type scale = (k % 3 == 0) ? 1.5f : 10.0f;
+      point_type p = {scale * frac(0.7548776662 * k),
+                      scale * frac(0.5698402910 * k),
+                      scale * frac(0.3370453736 * k)};
+      if (k % 2 == 0) {
+        s.push_back(p);
+        q.push_back(0.5f + frac(0.618034 * k));
+      }
+      else {
+        t.push_back(p);
+      }
+    }
+  }
+
+  static real_type frac(double x) { return x - floor(x); }
+
+  // Largest error of the fast transform, relative to the sum of the weights
+  double RelativeError(real_type delta, real_type epsilon,
+                       DiffusionSolver solver = DiffusionSolver::UNIFORM) {
+    FastGaussTransform3D fast(q, s, t, delta, epsilon);
+    FastGaussTransform3D direct(q, s, t, delta, epsilon);
+    if (solver == DiffusionSolver::ADAPTIVE)
+      fast.adaptive_transform();
+    else if (solver == DiffusionSolver::MESH)
+      fast.mesh_transform();
+    else
+      fast.fast_transform();
+    direct.direct_transform();
+    evals = fast.evals();
+
+    double Q = 0.0;
+    for (real_type qj : q) Q += fabs(qj);
+    double error = 0.0;
+    for (size_t i = 0; i < t.size(); i++)
+      error = fmax(error, fabs(fast.G()[i] - direct.G()[i]));
+    return error / Q;
+  }
+
+  std::vector<real_type> q;
+  std::vector<point_type> s;
+  std::vector<point_type> t;
+  std::array<uint32_t, 4> evals;
+};
+
+TEST_F(TestFastGaussTransform, ErrorIsBelowTolerance)
+{
+  for (real_type delta : {1.0f, 4.0f, 20.0f}) {
+    EXPECT_LT(RelativeError(delta, 1e-3), 1e-3) << "delta = " << delta;
+    EXPECT_LT(RelativeError(delta, 1e-5), 1e-5) << "delta = " << delta;
+  }
+}
+
+TEST_F(TestFastGaussTransform, DirectSumIsWithinToleranceOfFullSum)
+{
+  for (real_type delta : {1.0f, 4.0f, 20.0f}) {
+    FastGaussTransform3D direct(q, s, t, delta, 1e-4);
+    direct.direct_transform();
+    double Q = 0.0;
+    for (real_type qj : q) Q += fabs(qj);
+    for (size_t i = 0; i < t.size(); i += 7) {
+      double G = 0.0;
+      for (size_t j = 0; j < s.size(); j++) {
+        double d2 = 0.0;
+        for (int d = 0; d < 3; d++) d2 += (s[j][d] - t[i][d]) * (s[j][d] - t[i][d]);
+        G += q[j] * exp(-d2 / delta);
+      }
+      EXPECT_LT(fabs(direct.G()[i] - G), 1e-4 * Q) << "delta = " << delta;
+    }
+  }
+}
+
+TEST_F(TestFastGaussTransform, UsesAllInteractionKinds)
+{
+  RelativeError(4.0f, 1e-3);
+  for (int kind = 0; kind < 4; kind++)
+    EXPECT_GT(evals[kind], 0u) << "interaction kind " << kind;
+}
+
+TEST_F(TestFastGaussTransform, AdaptiveErrorIsBelowTolerance)
+{
+  for (real_type delta : {1.0f, 4.0f, 20.0f}) {
+    EXPECT_LT(RelativeError(delta, 1e-3, DiffusionSolver::ADAPTIVE), 1e-3) << "delta = " << delta;
+    EXPECT_LT(RelativeError(delta, 1e-5, DiffusionSolver::ADAPTIVE), 1e-5) << "delta = " << delta;
+  }
+}
+
+TEST_F(TestFastGaussTransform, AdaptiveUsesExpansions)
+{
+  RelativeError(4.0f, 1e-3, DiffusionSolver::ADAPTIVE);
+  EXPECT_GT(evals[1] + evals[2] + evals[3], 0u);
+}
+
+TEST_F(TestFastGaussTransform, MeshErrorIsBelowTolerance)
+{
+  for (real_type delta : {1.0f, 4.0f, 20.0f, 200.0f}) {
+    EXPECT_LT(RelativeError(delta, 1e-2, DiffusionSolver::MESH), 1e-2) << "delta = " << delta;
+    EXPECT_LT(RelativeError(delta, 1e-4, DiffusionSolver::MESH), 1e-4) << "delta = " << delta;
+  }
+}
+
+TEST_F(TestFastGaussTransform, SignalsTransformedTogetherMatchSeparately)
+{
+  // Second signal: other weights on the same sources, some of them 0
+  std::vector<real_type> q2(q.size());
+  for (size_t j = 0; j < q.size(); j++)
+    q2[j] = (j % 5 == 0) ? 0.0f : 2.0f - q[j];
+  std::vector<real_type> q12(q);
+  q12.insert(q12.end(), q2.begin(), q2.end());
+
+  for (DiffusionSolver solver : {DiffusionSolver::UNIFORM,
+                                 DiffusionSolver::ADAPTIVE,
+                                 DiffusionSolver::MESH}) {
+    FastGaussTransform3D both(q12, s, t, 4.0f, 1e-3);
+    FastGaussTransform3D first(q, s, t, 4.0f, 1e-3);
+    FastGaussTransform3D second(q2, s, t, 4.0f, 1e-3);
+    for (FastGaussTransform3D* fgt : {&both, &first, &second}) {
+      if (solver == DiffusionSolver::ADAPTIVE)
+        fgt->adaptive_transform();
+      else if (solver == DiffusionSolver::MESH)
+        fgt->mesh_transform();
+      else
+        fgt->fast_transform();
+    }
+    ASSERT_EQ(both.G().size(), 2 * t.size());
+    for (size_t i = 0; i < t.size(); i++) {
+      EXPECT_EQ(both.G()[i], first.G()[i]);
+      EXPECT_EQ(both.G()[t.size() + i], second.G()[i]);
+    }
+  }
+}
+
+TEST_F(TestFastGaussTransform, CalibratedCostsKeepErrorBelowTolerance)
+{
+  FastGaussTransform3D fast(q, s, t, 4.0f, 1e-3);
+  FastGaussTransform3D direct(q, s, t, 4.0f, 1e-3);
+  fast.calibrate();
+  EXPECT_TRUE(fast.tuned());
+  EXPECT_GT(fast.madd_cost(), 0.0);
+  EXPECT_GT(fast.exp_cost(), 0.0);
+  fast.fast_transform();
+  direct.direct_transform();
+
+  double Q = 0.0;
+  for (real_type qj : q) Q += fabs(qj);
+  for (size_t i = 0; i < t.size(); i++)
+    EXPECT_LT(fabs(fast.G()[i] - direct.G()[i]), 1e-3 * Q);
+}
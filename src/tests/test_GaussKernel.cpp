@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "fgt/GaussKernel.h"
+
+
+TEST(TestGaussKernel, ExpIsAccurate)
+{
+  for (float x = -87.0f; x <= 0.0f; x += 0.125f)
+    EXPECT_NEAR(1.0, GaussKernel::Exp(x) / exp((double) x), 3e-7) << "x = " << x;
+}
+
+TEST(TestGaussKernel, MatchesGaussiansWithinCutoff)
+{
+  // Sources from the target to beyond the cutoff radius, in various
+  // directions. 45 is not a multiple of the vector widths
+  const float tx = 0.5f, ty = -0.25f, tz = 1.0f;
+  const float delta = 2.0f, cutoff2 = 9.0f;
+  std::vector<float> x, y, z;
+  for (int k = 0; k < 45; k++) {
+    float r = 0.1f * k;
+    float theta = 0.7f * k, phi = 0.3f * k;
+    x.push_back(tx + r * sin(theta) * cos(phi));
+    y.push_back(ty + r * sin(theta) * sin(phi));
+    z.push_back(tz + r * cos(theta));
+  }
+
+  // Every path gives the very same values as the scalar one
+  std::vector<float> scalar;
+  for (auto isa : Simd::supported()) {
+    std::vector<float> g(x.size(), -1.0f);
+    GaussKernel::Gaussians(isa, x.size(), x.data(), y.data(), z.data(),
+                           tx, ty, tz, delta, cutoff2, g.data());
+    for (size_t j = 0; j < x.size(); j++) {
+      double d2 = (x[j] - tx) * (x[j] - tx) + (y[j] - ty) * (y[j] - ty) +
+                  (z[j] - tz) * (z[j] - tz);
+      if (d2 < cutoff2)
+        EXPECT_NEAR(exp(-d2 / delta), g[j], 1e-6) << "source " << j;
+      else
+        EXPECT_EQ(0.0f, g[j]) << "source " << j;
+    }
+    if (isa == Simd::Isa::SCALAR)
+      scalar = g;
+    else
+      EXPECT_EQ(scalar, g) << Simd::name(isa);
+  }
+}
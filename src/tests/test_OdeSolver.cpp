@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "OdeSolver.h"
+#include "OdeStore.h"
+
+
+const uint32_t L = OdeSolver::kLanes;
+
+/*
+ * y' = -k y, k the parameter of the lane
+ */
+void Decay(double, const double* y, const double* p, double* dydt) {
+  for (uint32_t c = 0; c < L; c++) {
+    dydt[c] = -p[c] * y[c];
+  }
+}
+
+/*
+ * Stiff system: y0 relaxes quickly (rate k) towards y1 = exp(-t)
+ */
+void Relaxation(double, const double* y, const double* p, double* dydt) {
+  for (uint32_t c = 0; c < L; c++) {
+    dydt[c] = -p[c] * (y[c] - y[L + c]);
+    dydt[L + c] = -y[L + c];
+  }
+}
+
+/*
+ * y' = -k y, the derivative is NaN where y < 0 (e.g. the square root of a
+ * concentration)
+ */
+void NanBelowZero(double, const double* y, const double* p, double* dydt) {
+  for (uint32_t c = 0; c < L; c++) {
+    dydt[c] = -p[c] * sqrt(y[c]) * sqrt(y[c]);
+  }
+}
+
+class TestOdeSolver : public testing::Test {
+protected:
+  virtual void SetUp() {
+    rate.clear();
+    y.clear();
+    for (uint32_t c = 0; c < L; c++) {
+      rate.push_back(0.5 + 0.25 * c);
+      y.push_back(1.0 + c);
+    }
+    active.assign(L, 1);
+  }
+
+  void Integrate(const OdeSolver::Settings& settings, double dt, int nb_calls) {
+    OdeSolver solver(&Decay, 1, settings);
+    double h = 0.0;
+    for (int call = 0; call < nb_calls; call++) {
+      solver.Integrate(call * dt, dt, y.data(), rate.data(), active.data(), h);
+    }
+  }
+
+  std::vector<double> rate, y;
+  std::vector<uint8_t> active;
+};
+
+TEST_F(TestOdeSolver, Rk4MatchesExponential)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::RK4;
+  settings.nb_steps = 10;
+  Integrate(settings, 0.5, 4);
+  for (uint32_t c = 0; c < L; c++) {
+    EXPECT_NEAR((1.0 + c) * exp(-2.0 * rate[c]), y[c], 1e-6);
+  }
+}
+
+TEST_F(TestOdeSolver, Rk45MeetsTolerance)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::RK45;
+  settings.tolerance = 1e-8;
+  Integrate(settings, 0.5, 4);
+  for (uint32_t c = 0; c < L; c++) {
+    EXPECT_NEAR((1.0 + c) * exp(-2.0 * rate[c]), y[c], 1e-6);
+  }
+}
+
+TEST_F(TestOdeSolver, Ros2MeetsTolerance)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::ROS2;
+  settings.tolerance = 1e-6;
+  Integrate(settings, 0.5, 4);
+  for (uint32_t c = 0; c < L; c++) {
+    EXPECT_NEAR((1.0 + c) * exp(-2.0 * rate[c]), y[c], 1e-4);
+  }
+}
+
+TEST_F(TestOdeSolver, Ros2SolvesStiffSystems)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::ROS2;
+  settings.tolerance = 1e-4;
+  OdeSolver solver(&Relaxation, 2, settings);
+
+  std::vector<double> k(L), y(2 * L);
+  for (uint32_t c = 0; c < L; c++) {
+    k[c] = 1e3 * (c + 1);
+    y[c] = 2.0;
+    y[L + c] = 1.0;
+  }
+  double h = 0.0;
+  solver.Integrate(0.0, 1.0, y.data(), k.data(), active.data(), h);
+
+  // The quickly relaxing part has vanished, then the step is only limited
+  // by the slow dynamics, far above the stability limit of explicit methods
+  EXPECT_GT(h, 0.01);
+  for (uint32_t c = 0; c < L; c++) {
+    double y1 = exp(-1.0);
+    EXPECT_NEAR(k[c] / (k[c] - 1.0) * y1, y[c], 1e-3);
+    EXPECT_NEAR(y1, y[L + c], 1e-3);
+  }
+}
+
+TEST_F(TestOdeSolver, InactiveLanesDoNotControlTheStep)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::RK45;
+  active[1] = 0;
+  Integrate(settings, 1.0, 1);
+  std::vector<double> reference = y;
+
+  // Lane 1 holds no cell, fast dynamics there do not change the others
+  SetUp();
+  active[1] = 0;
+  rate[1] = 1e6;
+  Integrate(settings, 1.0, 1);
+  for (uint32_t c = 0; c < L; c++) {
+    if (c == 1) continue;
+    EXPECT_EQ(reference[c], y[c]);
+  }
+}
+
+TEST_F(TestOdeSolver, NanRejectsTheStep)
+{
+  // The first step overshoots below 0 in lane 0 only, where the right-hand
+  // side is then NaN: it must be rejected whatever the other lanes
+  rate[0] = 50.0;
+  for (auto method : {OdeSolver::Method::RK45, OdeSolver::Method::ROS2}) {
+    OdeSolver::Settings settings;
+    settings.method = method;
+    OdeSolver solver(&NanBelowZero, 1, settings);
+    std::vector<double> y0 = y;
+    double h = 0.0;
+    solver.Integrate(0.0, 1.0, y0.data(), rate.data(), active.data(), h);
+    for (uint32_t c = 0; c < L; c++) {
+      EXPECT_NEAR((1.0 + c) * exp(-rate[c]), y0[c], 1e-3)
+          << OdeSolver::name(method) << ", lane " << c;
+    }
+  }
+}
+
+TEST(TestOdeStore, LanesAreReusedLowestFirst)
+{
+  OdeStore store(&Decay, 1, 1, OdeSolver::Settings());
+  std::vector<uint32_t> lanes;
+  for (uint32_t i = 0; i < L + 2; i++) {
+    lanes.push_back(store.Acquire());
+    EXPECT_EQ(i, lanes.back());
+  }
+  store.Release(5);
+  store.Release(3);
+  EXPECT_EQ(L, store.nb_cells());
+  EXPECT_EQ(3u, store.Acquire());
+  EXPECT_EQ(5u, store.Acquire());
+  EXPECT_EQ(L + 2, store.Acquire());
+}
+
+TEST(TestOdeStore, CopiesAndIntegratesLanes)
+{
+  OdeSolver::Settings settings;
+  settings.method = OdeSolver::Method::RK4;
+  settings.nb_steps = 20;
+  OdeStore store(&Decay, 1, 1, settings);
+
+  uint32_t mother = store.Acquire();
+  store.y(mother, 0) = 2.0;
+  store.p(mother, 0) = 0.1;
+  for (uint32_t i = 0; i < L; i++) store.Acquire();
+  uint32_t daughter = store.Acquire(mother);
+  ASSERT_GE(daughter, L); // in the second block
+  EXPECT_EQ(2.0, store.y(daughter, 0));
+  EXPECT_EQ(0.1, store.p(daughter, 0));
+
+  store.Integrate(0.0, 1.0, 1);
+  EXPECT_NEAR(2.0 * exp(-0.1), store.y(mother, 0), 1e-9);
+  EXPECT_EQ(store.y(mother, 0), store.y(daughter, 0));
+
+  store.Release(daughter);
+  EXPECT_EQ(0.0, store.y(daughter, 0));
+}
@@ -0,0 +1,17 @@
+#include "gtest/gtest.h"
+
+#include "Simd.h"
+
+
+TEST(TestSimd, ScalarPathIsAlwaysSupported)
+{
+  EXPECT_TRUE(Simd::Supports(Simd::Isa::SCALAR));
+  ASSERT_FALSE(Simd::supported().empty());
+  EXPECT_EQ(Simd::Isa::SCALAR, Simd::supported().front());
+}
+
+TEST(TestSimd, DefaultPathIsTheFastestSupported)
+{
+  EXPECT_TRUE(Simd::Supports(Simd::isa()));
+  EXPECT_EQ(Simd::supported().back(), Simd::isa());
+}
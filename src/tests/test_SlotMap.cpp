@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "SlotMap.h"
+
+
+static std::vector<int> contents(const SlotMap<int>& map) {
+  return std::vector<int>(map.begin(), map.end());
+}
+
+
+class TestSlotMap : public testing::Test {
+protected:
+  virtual void SetUp() {
+    for (int i = 0; i < 5; i++) handles.push_back(map.insert(10 * i));
+  }
+
+  SlotMap<int> map;
+  std::vector<SlotMap<int>::Handle> handles;
+};
+
+TEST_F(TestSlotMap, IteratesInInsertionOrder)
+{
+  EXPECT_EQ(5u, map.size());
+  EXPECT_EQ(std::vector<int>({0, 10, 20, 30, 40}), contents(map));
+  EXPECT_EQ(30, map[handles[3]]);
+}
+
+TEST_F(TestSlotMap, EraseSkipsTombstones)
+{
+  map.erase(handles[0]);
+  map.erase(handles[3]);
+  EXPECT_EQ(3u, map.size());
+  EXPECT_FALSE(map.contains(handles[0]));
+  EXPECT_FALSE(map.contains(handles[3]));
+  EXPECT_EQ(std::vector<int>({10, 20, 40}), contents(map));
+}
+
+TEST_F(TestSlotMap, CompactionKeepsOrderAndHandles)
+{
+  map.erase(handles[1]);
+  map.erase(handles[2]);
+  map.compact();
+  EXPECT_EQ(std::vector<int>({0, 30, 40}), contents(map));
+  EXPECT_EQ(0, map[handles[0]]);
+  EXPECT_EQ(30, map[handles[3]]);
+  EXPECT_EQ(40, map[handles[4]]);
+}
+
+TEST_F(TestSlotMap, ReusedSlotsInvalidateOldHandles)
+{
+  map.erase(handles[2]);
+  SlotMap<int>::Handle handle = map.insert(50);
+  EXPECT_EQ(handles[2].index, handle.index);
+  EXPECT_FALSE(map.contains(handles[2]));
+  EXPECT_TRUE(map.contains(handle));
+  map.compact();
+  EXPECT_EQ(std::vector<int>({0, 10, 30, 40, 50}), contents(map));
+  EXPECT_EQ(50, map[handle]);
+}